@@ -0,0 +1,255 @@
+#include "typedef.hpp"
+#include "communicator.hpp"
+#include "grid.hpp"
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif // USE_MPI
+
+using namespace std;
+
+/// Minimum number of interior cells of a block in each direction
+#define COMM_MIN_BLOCK 2
+
+#ifdef USE_MPI
+/// MPI datatypes matching real_t and accum_t
+#define MPI_REAL_T (sizeof(real_t) == sizeof(double) ? MPI_DOUBLE : MPI_FLOAT)
+#define MPI_ACCUM_T (sizeof(accum_t) == sizeof(double) ? MPI_DOUBLE : MPI_FLOAT)
+
+/// Tags of the messages exchanged with Send and Receive. The tag encodes the
+/// side the message is sent to, so messages of both directions never match.
+#define COMM_TAG_SEND 100
+#endif // USE_MPI
+
+Communicator::Communicator()
+    : _tdim(1), _rank(0), _size(1), _mpi(false), _send(NULL), _recv(NULL) {
+}
+
+Communicator::Communicator(int *argc, char ***argv)
+    : Communicator() {
+  #ifdef USE_MPI
+  // Only the main thread communicates, the output thread just writes files
+  int provided;
+  MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
+  MPI_Comm_rank(MPI_COMM_WORLD, &_rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &_size);
+  _mpi = true;
+  #else
+  (void)argc;
+  (void)argv;
+  #endif // USE_MPI
+}
+
+Communicator::~Communicator() {
+  if (_send != NULL) delete[] _send;
+  if (_recv != NULL) delete[] _recv;
+
+  #ifdef USE_MPI
+  if (_mpi) MPI_Finalize();
+  #endif // USE_MPI
+}
+
+void Communicator::Decompose(const multi_index_t &cells) {
+  // Choose the factorization px * py of the process count that exchanges the
+  // fewest cells: (px - 1) interfaces of height ny and (py - 1) of width nx
+  index_t best = 0;
+  for (index_t px = 1; px <= index_t(_size); ++px) {
+    if (_size % px != 0) continue;
+    const index_t py = _size / px;
+    const index_t cost = (px - 1) * cells[1] + (py - 1) * cells[0];
+
+    if (px == 1 || cost < best) {
+      best = cost;
+      _tdim[0] = px;
+      _tdim[1] = py;
+    }
+  }
+
+  // Blocks are numbered row by row
+  _tidx[0] = _rank % _tdim[0];
+  _tidx[1] = _rank / _tdim[0];
+
+  _cells = cells;
+  if (cells[0] / _tdim[0] < COMM_MIN_BLOCK || cells[1] / _tdim[1] < COMM_MIN_BLOCK) {
+    throw runtime_error("Too many processes for the size of the domain!");
+  }
+
+  this->Block(_rank, _offset, _block);
+
+  // Buffers for packing one column including both ghost cells
+  if (_send != NULL) delete[] _send;
+  if (_recv != NULL) delete[] _recv;
+  _send = new real_t[_block[1] + 2];
+  _recv = new real_t[_block[1] + 2];
+}
+
+const multi_index_t &Communicator::ThreadIdx() const {
+  return _tidx;
+}
+
+const multi_index_t &Communicator::ThreadDim() const {
+  return _tdim;
+}
+
+const int &Communicator::ThreadNum() const {
+  return _rank;
+}
+
+const int &Communicator::ThreadCnt() const {
+  return _size;
+}
+
+const multi_index_t &Communicator::BlockSize() const {
+  return _block;
+}
+
+const multi_index_t &Communicator::BlockOffset() const {
+  return _offset;
+}
+
+void Communicator::Block(const int &rank, multi_index_t &offset, multi_index_t &size) const {
+  const multi_index_t tidx(rank % _tdim[0], rank / _tdim[0]);
+
+  // Distribute the cells evenly, the first blocks get the remainder
+  for (index_t dim = 0; dim < DIM; ++dim) {
+    const index_t base = _cells[dim] / _tdim[dim];
+    const index_t rem  = _cells[dim] % _tdim[dim];
+
+    size[dim]   = base + (tidx[dim] < rem ? 1 : 0);
+    offset[dim] = tidx[dim] * base + (tidx[dim] < rem ? tidx[dim] : rem);
+  }
+}
+
+bool Communicator::IsBoundary(const index_t &boundary) const {
+  return this->Neighbour(boundary) < 0;
+}
+
+int Communicator::Neighbour(const index_t &boundary) const {
+  switch (boundary) {
+    // Bottom
+    case 1:
+      return _tidx[1] > 0 ? _rank - int(_tdim[0]) : -1;
+    // Right
+    case 2:
+      return _tidx[0] + 1 < _tdim[0] ? _rank + 1 : -1;
+    // Top
+    case 3:
+      return _tidx[1] + 1 < _tdim[1] ? _rank + int(_tdim[0]) : -1;
+    // Left
+    case 4:
+      return _tidx[0] > 0 ? _rank - 1 : -1;
+  }
+  return -1;
+}
+
+accum_t Communicator::GatherSum(const accum_t &val) const {
+  #ifdef USE_MPI
+  if (_size > 1) {
+    accum_t res = val;
+    MPI_Allreduce(&val, &res, 1, MPI_ACCUM_T, MPI_SUM, MPI_COMM_WORLD);
+    return res;
+  }
+  #endif // USE_MPI
+  return val;
+}
+
+void Communicator::GatherSum(real_t *vals, const index_t &n) const {
+  #ifdef USE_MPI
+  if (_size > 1)
+    MPI_Allreduce(MPI_IN_PLACE, vals, n, MPI_REAL_T, MPI_SUM, MPI_COMM_WORLD);
+  #else
+  (void)vals;
+  (void)n;
+  #endif // USE_MPI
+}
+
+real_t Communicator::GatherMax(const real_t &val) const {
+  #ifdef USE_MPI
+  if (_size > 1) {
+    real_t res = val;
+    MPI_Allreduce(&val, &res, 1, MPI_REAL_T, MPI_MAX, MPI_COMM_WORLD);
+    return res;
+  }
+  #endif // USE_MPI
+  return val;
+}
+
+void Communicator::CopyBoundary(Grid *grid) const {
+  if (_size < 2) return;
+
+  // Exchange the columns first. The rows sent afterwards then already contain
+  // the ghost cells of the columns, which fills the corners.
+  this->CopyBoundary(grid, true);
+  this->CopyBoundary(grid, false);
+}
+
+void Communicator::CopyBoundary(Grid *grid, const bool &horizontal) const {
+  #ifdef USE_MPI
+  const index_t sx = _block[0] + 2;
+  const index_t sy = _block[1] + 2;
+  real_t *data = grid->Data();
+
+  if (horizontal) {
+    const int left  = this->Neighbour(4);
+    const int right = this->Neighbour(2);
+
+    // Last interior column to the right, ghost column from the left
+    for (index_t j = 0; j < sy; ++j) _send[j] = data[j*sx + sx - 2];
+    MPI_Sendrecv(_send, sy, MPI_REAL_T, right < 0 ? MPI_PROC_NULL : right, 2,
+      _recv, sy, MPI_REAL_T, left < 0 ? MPI_PROC_NULL : left, 2,
+      MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    if (left >= 0)
+      for (index_t j = 0; j < sy; ++j) data[j*sx] = _recv[j];
+
+    // First interior column to the left, ghost column from the right
+    for (index_t j = 0; j < sy; ++j) _send[j] = data[j*sx + 1];
+    MPI_Sendrecv(_send, sy, MPI_REAL_T, left < 0 ? MPI_PROC_NULL : left, 4,
+      _recv, sy, MPI_REAL_T, right < 0 ? MPI_PROC_NULL : right, 4,
+      MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    if (right >= 0)
+      for (index_t j = 0; j < sy; ++j) data[j*sx + sx - 1] = _recv[j];
+  } else {
+    const int down = this->Neighbour(1);
+    const int up   = this->Neighbour(3);
+
+    // Rows are contiguous and can be exchanged in place
+    MPI_Sendrecv(data + (sy - 2)*sx, sx, MPI_REAL_T, up < 0 ? MPI_PROC_NULL : up, 3,
+      data, sx, MPI_REAL_T, down < 0 ? MPI_PROC_NULL : down, 3,
+      MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(data + sx, sx, MPI_REAL_T, down < 0 ? MPI_PROC_NULL : down, 1,
+      data + (sy - 1)*sx, sx, MPI_REAL_T, up < 0 ? MPI_PROC_NULL : up, 1,
+      MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  }
+  #else
+  (void)grid;
+  (void)horizontal;
+  #endif // USE_MPI
+}
+
+void Communicator::Send(const real_t *data, const index_t &count, const index_t &boundary) const {
+  #ifdef USE_MPI
+  const int rank = this->Neighbour(boundary);
+  if (rank >= 0) {
+    MPI_Send(data, count, MPI_REAL_T, rank, COMM_TAG_SEND + boundary, MPI_COMM_WORLD);
+  }
+  #else
+  (void)data;
+  (void)count;
+  (void)boundary;
+  #endif // USE_MPI
+}
+
+void Communicator::Receive(real_t *data, const index_t &count, const index_t &boundary) const {
+  #ifdef USE_MPI
+  const int rank = this->Neighbour(boundary);
+  if (rank >= 0) {
+    // The neighbour sent towards the opposite side
+    const index_t opposite = (boundary + 1) % 4 + 1;
+    MPI_Recv(data, count, MPI_REAL_T, rank, COMM_TAG_SEND + opposite, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  }
+  #else
+  (void)data;
+  (void)count;
+  (void)boundary;
+  #endif // USE_MPI
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2015   Malte Brunn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//------------------------------------------------------------------------------
+#include "typedef.hpp"
+//------------------------------------------------------------------------------
+#ifndef __COMMUNICATOR_HPP
+#define __COMMUNICATOR_HPP
+//------------------------------------------------------------------------------
+
+/// Handles the communication between the processes of a parallel run. The
+/// domain is split into a 2D grid of rectangular blocks, one per process. Each
+/// process holds its block surrounded by one layer of ghost cells, which are
+/// filled with the values of the neighbouring blocks by CopyBoundary.
+///
+/// Without MPI (build option "mpi") there is only one process owning the whole
+/// domain and all communication methods are trivial.
+class Communicator {
+public:
+  /// Constructs a communicator for a single process without initializing MPI.
+  Communicator();
+
+  /// Constructs a communicator for all processes of the run and initializes
+  /// MPI if the program is built with it.
+  ///
+  /// @param argc int* The number of console parameters
+  /// @param argv char*** The console parameters
+  Communicator(int *argc, char ***argv);
+
+  /// Deconstructs the communicator and finalizes MPI if it was initialized.
+  ~Communicator();
+
+  /// Splits the given number of interior cells into one block per process.
+  /// The process grid is chosen to keep the boundaries between the blocks
+  /// short.
+  ///
+  /// @param cells multi_index_t The number of interior cells of the domain
+  void Decompose(const multi_index_t &cells);
+
+  /// Returns the position of the own block in the process grid.
+  ///
+  /// @return multi_index_t The position in x and y direction
+  const multi_index_t &ThreadIdx() const;
+
+  /// Returns the number of blocks in each direction.
+  ///
+  /// @return multi_index_t The number of blocks in x and y direction
+  const multi_index_t &ThreadDim() const;
+
+  /// Returns the number of the own process.
+  ///
+  /// @return int The rank of the process
+  const int &ThreadNum() const;
+
+  /// Returns the number of processes.
+  ///
+  /// @return int The number of processes
+  const int &ThreadCnt() const;
+
+  /// Returns the number of interior cells of the own block.
+  ///
+  /// @return multi_index_t The number of cells in x and y direction
+  const multi_index_t &BlockSize() const;
+
+  /// Returns the global index of the lower left ghost cell of the own block.
+  /// Adding it to a local index gives the global index.
+  ///
+  /// @return multi_index_t The offset in x and y direction
+  const multi_index_t &BlockOffset() const;
+
+  /// Returns the block of any process.
+  ///
+  /// @param rank int The number of the process
+  /// @param offset multi_index_t Returns the global index of the lower left
+  ///   ghost cell of the block
+  /// @param size multi_index_t Returns the number of interior cells
+  void Block(const int &rank, multi_index_t &offset, multi_index_t &size) const;
+
+  /// Returns whether the given side of the own block lies on the domain
+  /// boundary. Otherwise a neighbouring block lies on this side.
+  ///
+  /// @see BoundaryIterator::BoundaryIterator() for how the boundaries are
+  ///   numbered
+  /// @param boundary index_t The side of the block
+  /// @return bool True if the side is part of the domain boundary
+  bool IsBoundary(const index_t &boundary) const;
+
+  /// Returns the sum of the given value over all processes.
+  ///
+  /// @param val accum_t The value of this process
+  /// @return accum_t The sum of all values
+  accum_t GatherSum(const accum_t &val) const;
+
+  /// Sums each of the given values over all processes in a single exchange.
+  ///
+  /// @param vals real_t* The values of this process, replaced by the sums
+  /// @param n index_t The number of values
+  void GatherSum(real_t *vals, const index_t &n) const;
+
+  /// Returns the maximum of the given value over all processes.
+  ///
+  /// @param val real_t The value of this process
+  /// @return real_t The maximum of all values
+  real_t GatherMax(const real_t &val) const;
+
+  /// Fills the ghost cells of the grid on all sides with neighbouring blocks
+  /// by the values of these blocks. The corner cells are included, so that
+  /// diagonal neighbours are available as well.
+  ///
+  /// @param grid Grid The grid to exchange
+  void CopyBoundary(Grid *grid) const;
+
+  /// Sends values to the neighbouring block on the given side. Does nothing
+  /// if the side lies on the domain boundary.
+  ///
+  /// @param data real_t* The values
+  /// @param count index_t The number of values
+  /// @param boundary index_t The side of the block
+  void Send(const real_t *data, const index_t &count, const index_t &boundary) const;
+
+  /// Receives values from the neighbouring block on the given side. Does
+  /// nothing if the side lies on the domain boundary.
+  ///
+  /// @param data real_t* The values
+  /// @param count index_t The number of values
+  /// @param boundary index_t The side of the block
+  void Receive(real_t *data, const index_t &count, const index_t &boundary) const;
+
+private:
+  /// _cells multi_index_t The number of interior cells of the domain
+  multi_index_t _cells;
+
+  /// _tidx multi_index_t The position of the own block in the process grid
+  multi_index_t _tidx;
+
+  /// _tdim multi_index_t The number of blocks in each direction
+  multi_index_t _tdim;
+
+  /// _rank int The number of the own process
+  int _rank;
+
+  /// _size int The number of processes
+  int _size;
+
+  /// _block multi_index_t The number of interior cells of the own block
+  multi_index_t _block;
+
+  /// _offset multi_index_t The global index of the lower left ghost cell
+  multi_index_t _offset;
+
+  /// _mpi bool True if MPI was initialized by this instance
+  bool _mpi;
+
+  /// _send real_t* Buffer for packing the values sent by CopyBoundary
+  real_t *_send;
+
+  /// _recv real_t* Buffer for the values received by CopyBoundary
+  real_t *_recv;
+
+  /// Returns the rank of the neighbouring block on the given side or -1 if the
+  /// side lies on the domain boundary.
+  ///
+  /// @param boundary index_t The side of the block
+  /// @return int The rank of the neighbour
+  int Neighbour(const index_t &boundary) const;
+
+  /// Copies the ghost cells of one direction. Values are sent towards the
+  /// first side and received from the second side, then the other way round.
+  ///
+  /// @param grid Grid The grid to exchange
+  /// @param horizontal bool True for the left and right sides
+  void CopyBoundary(Grid *grid, const bool &horizontal) const;
+};
+//------------------------------------------------------------------------------
+#endif // __COMMUNICATOR_HPP
@@ -5,6 +5,7 @@
 #include "iterator.hpp"
 #include "parameter.hpp"
 #include "solver.hpp"
+#include "communicator.hpp"
 
 #include <cmath>
 
@@ -13,6 +14,17 @@ using namespace std;
 #define DYNAMIC_TIMESTEP true
 #define PARTICLE_PERIOD 5
 
+/// Number of particles interpolated together by one thread
+#define PARTICLE_CHUNK 256
+
+/// Upper bound of the cycles between two residual checks of the pressure
+/// solver if they are chosen from the observed convergence
+#define RESCHECK_MAX 50
+
+/// Minimum number of cycles of a pressure solve whose final convergence is
+/// used to adapt the solver
+#define ADAPT_CYCLES 10
+
 Compute::Compute(const Geometry *geom, const Parameter *param, const Substance *subst)
     : _geom(geom), _param(param), _subst(subst) {
   
@@ -40,6 +52,7 @@ Compute::Compute(const Geometry *geom, const Parameter *param, const Substance *
   _G   = new Grid(geom);
   _rhs = new Grid(geom);
   _tmp = new Grid(geom);
+
   
   // Create visu fields for stream lines and GetVorticity
   multi_real_t offset_visufields;
@@ -49,6 +62,39 @@ Compute::Compute(const Geometry *geom, const Parameter *param, const Substance *
   
   _stream = new Grid(geom, offset_visufields);
   _vort   = new Grid(geom, offset_visufields);
+
+  // History of the pressure for the predictor and RHS of the last solve
+  _p_last   = NULL;
+  _p_prev   = NULL;
+  _rhs_last = NULL;
+  if (_param->Predictor() > 0) {
+    _p_last = new Grid(geom, offset_p);
+    _p_prev = new Grid(geom, offset_p);
+  }
+  if (_param->RhsSkip() > 0.0)
+    _rhs_last = new Grid(geom);
+  _t_p[0] = _t_p[1] = _t_p[2] = 0.0;
+  _n_p = 0;
+
+  // The Runge-Kutta schemes interpolate the velocities in time, so they need
+  // those at the start of the time step
+  _u_old    = NULL;
+  _v_old    = NULL;
+  _substeps = 1;
+  switch (_param->Integrator()) {
+    case 1:
+      break;
+    case 2:
+    case 4:
+      if (_param->ParticleCfl() <= 0.0)
+        throw std::runtime_error("The particle CFL number has to be positive!");
+      _u_old = new Grid(geom, offset_u);
+      _v_old = new Grid(geom, offset_v);
+      break;
+    default:
+      throw std::runtime_error(std::string("Unknown particle integrator: " + std::to_string(_param->Integrator())));
+      break;
+  }
   
   // Init velocity / pressure fields
   geom->Update_U(_u);
@@ -58,17 +104,77 @@ Compute::Compute(const Geometry *geom, const Parameter *param, const Substance *
   // Init time
   _t = 0.0;
 
+  // No derived field has been computed yet
+  _version = 1;
+  _version_velocity = _version_vort = _version_stream = 0;
+
   // Compute solver time step limitation on diffusive part and check against similar restrictions
   // for each substance diffusion terms. We select the minimum of all.
   _diff = _param->Re() * (pow(_geom->Mesh()[0], 2.0) * pow(_geom->Mesh()[1], 2.0))
     / (4 * (pow(_geom->Mesh()[0], 2.0) + pow(_geom->Mesh()[1], 2.0)));
   for (index_t i = 0; i < _subst->N(); i++) {
-    _diff = min(_diff, (pow(_geom->Mesh()[0], 2.0) * pow(_geom->Mesh()[1], 2.0))
-      / (2 * _subst->D(i) * (pow(_geom->Mesh()[0], 2.0) + pow(_geom->Mesh()[1], 2.0))));
+    _diff = min(_diff, real_t((pow(_geom->Mesh()[0], 2.0) * pow(_geom->Mesh()[1], 2.0))
+      / (2 * _subst->D(i) * (pow(_geom->Mesh()[0], 2.0) + pow(_geom->Mesh()[1], 2.0)))));
   }
   
-  // Init _solver
-  _solver = new SOR(_geom,_param->Omega());
+  // Init _solver. Obstacle-free rectangles are solved directly unless this
+  // is disabled in the parameter file.
+  index_t solver = _param->SolverId();
+  const bool parallel = _geom->Comm()->ThreadCnt() > 1;
+  if (!parallel && _param->Direct() && FFTSolver::Applicable(_geom))
+    solver = SolverType::FFT_Direct;
+
+  // Only the red-black SOR solver exchanges values between the blocks of a
+  // parallel run
+  if (parallel && solver != SolverType::SOR_RedBlack) {
+    printf("Parallel run: using the red-black SOR solver\n");
+    solver = SolverType::SOR_RedBlack;
+  }
+
+#ifdef USE_OPENMP
+  // The lexicographic sweep cannot be split across threads
+  if (solver == SolverType::SOR_Lexicographic) {
+    printf("Threaded build: using the red-black SOR solver\n");
+    solver = SolverType::SOR_RedBlack;
+  }
+#endif
+
+  // The SSOR preconditioner takes the automatic omega of the SOR solvers
+  real_t omega = _param->Omega();
+  if (solver == SolverType::PCG_Solver && omega <= 0.0) {
+    bool exact;
+    omega = SOR::OptimalOmega(_geom, exact);
+  }
+
+  switch (solver) {
+    case SolverType::SOR_RedBlack:
+      _solver = new RedBlackSOR(_geom, _param->Omega());
+      break;
+
+    case SolverType::Multigrid_V:
+      _solver = new Multigrid(_geom, 1);
+      break;
+
+    case SolverType::Multigrid_W:
+      _solver = new Multigrid(_geom, 2);
+      break;
+
+    case SolverType::PCG_Solver:
+      _solver = new PCG(_geom, _param->Precond(), omega, _param->Eps(), _param->IterMax());
+      break;
+
+    case SolverType::FFT_Direct:
+      _solver = new FFTSolver(_geom);
+      break;
+
+    case SolverType::SOR_Lexicographic:
+      _solver = new SOR(_geom, _param->Omega());
+      break;
+
+    default:
+      throw std::runtime_error(std::string("Unknown solver type: " + std::to_string(solver)));
+      break;
+  }
   // Init _dtlimit
   _dtlimit = _param->Dt();
   // Init _epslimit
@@ -79,17 +185,12 @@ Compute::Compute(const Geometry *geom, const Parameter *param, const Substance *
   
   // Init particles from data loaded in geometry
   particles_t streaklines = _geom->Streaklines();
-  for (iter_particles_t it = streaklines.begin(); it != streaklines.end(); ++it) {
-    particles_t newList;
-    newList.push_back((*it));
-    _streakline.push_back(newList);
-  }
+  for (iter_particles_t it = streaklines.begin(); it != streaklines.end(); ++it)
+    _streakline.AddLine((*it)[0], (*it)[1], this->IsValidParticle((*it)[0], (*it)[1]));
+
   particles_t traces = _geom->ParticleTraces();
-  for (iter_particles_t it = traces.begin(); it != traces.end(); ++it) {
-    particles_t newList;
-    newList.push_back((*it));
-    _trace.push_back(newList);
-  }
+  for (iter_particles_t it = traces.begin(); it != traces.end(); ++it)
+    _trace.AddLine((*it)[0], (*it)[1], this->IsValidParticle((*it)[0], (*it)[1]));
 }
 
 Compute::~Compute() {
@@ -105,6 +206,12 @@ Compute::~Compute() {
   delete _tmp;
   delete _stream;
   delete _vort;
+
+  delete _p_last;
+  delete _p_prev;
+  delete _rhs_last;
+  delete _u_old;
+  delete _v_old;
   
   delete _solver;
 }
@@ -130,67 +237,113 @@ const Grid *Compute::GetRHS() const{
 }
 
 const Grid *Compute::GetVelocity() {
-  // Create Iterator
-  Iterator it = Iterator(_geom);
-  
-  // Go through all cells and calculate absolute velocity (u_x^2 + u_y^2)^(1/2)
-  while(it.Valid()){
-    _tmp->Cell(it) = sqrt( pow(_u->Cell(it),2.0) + pow(_v->Cell(it),2.0) );
-    it.Next();
-  }
+  this->UpdateDerived(DerivedField::Derived_Velocity);
   return _tmp;
 }
 
 const Grid *Compute::GetVorticity() {
-  Iterator it = Iterator(_geom);
-
-  while (it.Valid()) {
-    if (_geom->CellTypeAt(it) == CellType::Fluid)
-      _vort->Cell(it) = _u->dy_r(it) - _v->dx_r(it);
-    it.Next();
-  }
-
+  this->UpdateDerived(DerivedField::Derived_Vorticity);
   return _vort;
 }
 
 const Grid *Compute::GetStream() {
-  Iterator it = Iterator(_geom);
-  
-  // Init first cell with a fixed value
-  _stream->Cell(it) = 0.0;
-  it.Next();
+  this->UpdateDerived(DerivedField::Derived_Stream);
+  return _stream;
+}
 
-  // Calculate integral over first row in x-direction
-  while (it < _geom->Size()[0]) {
-    _stream->Cell(it) = _stream->Cell(it.Left()) - _geom->Mesh()[0] * _v->Cell(it);
-    it.Next();
-  }
-  
-  // Calculate integrals in y-direction
-  while (it.Valid()) {
-    if (_geom->CellTypeAt(it) != CellType::Obstacle) {
-      _stream->Cell(it) = _stream->Cell(it.Down()) + _geom->Mesh()[1] * _u->Cell(it);
-    } else {
-      _stream->Cell(it) = _stream->Cell(it.Down());
+void Compute::UpdateDerived(const index_t &fields) {
+  const bool velocity =
+    (fields & DerivedField::Derived_Velocity) && _version_velocity != _version;
+  const bool vorticity =
+    (fields & DerivedField::Derived_Vorticity) && _version_vort != _version;
+  const bool stream =
+    (fields & DerivedField::Derived_Stream) && _version_stream != _version;
+
+  if (velocity || vorticity) {
+    Iterator it = Iterator(_geom);
+
+    // Go through all cells and calculate absolute velocity (u_x^2 + u_y^2)^(1/2)
+    // and the vorticity of the fluid cells
+    while (it.Valid()) {
+      if (velocity)
+        _tmp->Cell(it) = sqrt( pow(_u->Cell(it),2.0) + pow(_v->Cell(it),2.0) );
+      if (vorticity && _geom->CellTypeAt(it) == CellType::Fluid)
+        _vort->Cell(it) = _u->dy_r(it) - _v->dx_r(it);
+      it.Next();
     }
-    it.Next();
   }
 
-  return _stream;
+  if (velocity)
+    _version_velocity = _version;
+
+  if (vorticity) {
+    // The differences in the last row and column lack their upper and right
+    // neighbours, so take these values from the neighbouring blocks
+    _geom->Comm()->CopyBoundary(_vort);
+    _version_vort = _version;
+  }
+
+  if (stream) {
+    this->Stream();
+    _version_stream = _version;
+  }
 }
 
-list<particles_t> *Compute::GetParticleTracing(){
+const Particles *Compute::GetParticleTracing() const{
   return &_trace;
 }
 
-list<particles_t> *Compute::GetStreaklines(){
+const Particles *Compute::GetStreaklines() const{
   return &_streakline;
 }
 
+void Compute::WriteCheckpoint(FILE *handle) const {
+  if (fwrite(&_t, sizeof(_t), 1, handle) != 1)
+    throw runtime_error("Failed to write the checkpoint!");
+  _u->Write(handle);
+  _v->Write(handle);
+  _p->Write(handle);
+  _solver->WriteCheckpoint(handle);
+  if (fwrite(_t_p, sizeof(_t_p[0]), 3, handle) != 3 ||
+      fwrite(&_n_p, sizeof(_n_p), 1, handle) != 1)
+    throw runtime_error("Failed to write the checkpoint!");
+  if (_p_last) {
+    _p_last->Write(handle);
+    _p_prev->Write(handle);
+  }
+  if (_rhs_last)
+    _rhs_last->Write(handle);
+  _streakline.Write(handle);
+  _trace.Write(handle);
+}
+
+void Compute::ReadCheckpoint(FILE *handle) {
+  if (fread(&_t, sizeof(_t), 1, handle) != 1)
+    throw runtime_error("Failed to read the checkpoint!");
+  _u->Read(handle);
+  _v->Read(handle);
+  _p->Read(handle);
+  _solver->ReadCheckpoint(handle);
+  if (fread(_t_p, sizeof(_t_p[0]), 3, handle) != 3 ||
+      fread(&_n_p, sizeof(_n_p), 1, handle) != 1)
+    throw runtime_error("Failed to read the checkpoint!");
+  if (_p_last) {
+    _p_last->Read(handle);
+    _p_prev->Read(handle);
+  }
+  if (_rhs_last)
+    _rhs_last->Read(handle);
+  _streakline.Read(handle);
+  _trace.Read(handle);
+
+  // The derived fields belong to the replaced velocities
+  _version++;
+}
+
 bool Compute::TimeStep(int stepNr) {
   // Compute candidates for current time step
-  const real_t cfl_x = _geom->Mesh()[0] / _u->AbsMax();
-  const real_t cfl_y = _geom->Mesh()[1] / _v->AbsMax();
+  const real_t cfl_x = _geom->Mesh()[0] / _geom->Comm()->GatherMax(_u->AbsMax());
+  const real_t cfl_y = _geom->Mesh()[1] / _geom->Comm()->GatherMax(_v->AbsMax());
   
   // Compute smallest time step from all candidates with some security factor
   // and a minimum timestep
@@ -220,22 +373,78 @@ bool Compute::TimeStep(int stepNr) {
   // Compute RHS
   this->RHS(dt);
 
-  // Solve Poisson equation (-> p)
+  // Keep the pressure if the RHS did not change noticeably, otherwise start
+  // the solver from the extrapolated pressure
+  const bool skip = _rhs_last && this->SkipSolve();
+  if (!skip && _p_last)
+    this->Predict(_t + dt);
+
+  // Solve Poisson equation (-> p). The residual is only computed in every
+  // check-th cycle, the solver smoothes without it in between.
+  const index_t itermax = _param->IterMax();
   index_t it(0);
-  real_t  res(_epslimit + 0.1);
-  while((it < _param->IterMax()) && (res >= _epslimit))  {
+  index_t check(_param->ResCheck() > 0 ? _param->ResCheck() : 1);
+  index_t it_check(0);
+  index_t it_prev(0);
+  real_t  res(skip ? 0.0 : _epslimit + 0.1);
+  real_t  res_check(res);
+  real_t  res_prev(res);
+  while((it < itermax) && (res >= _epslimit))  {
+    it += _solver->Smooth(_p, _rhs, min(check, itermax - it) - 1);
     res = _solver->Cycle(_p, _rhs);
     it++;
     // Set boundary values in each iter, because it changes with each iter
     _geom->Update_P(_p);
+
+    // Estimate the remaining cycles from the contraction per cycle since the
+    // last check; check every cycle while the residual does not decrease
+    if (_param->ResCheck() == 0 && it_check > 0) {
+      check = 1;
+      if (res < res_check && res >= _epslimit) {
+        const real_t rate = pow(res / res_check, real_t(1.0) / (it - it_check));
+        const real_t rest = ceil(log(_epslimit / res) / log(rate));
+        check = index_t(min(max(rest, real_t(1.0)), real_t(RESCHECK_MAX)));
+      }
+    }
+    it_prev   = it_check;
+    res_prev  = res_check;
+    it_check  = it;
+    res_check = res;
+  }
+
+  // After some cycles the contraction between the last two checks is close
+  // to the asymptotic one of the solver
+  if (!skip && it >= ADAPT_CYCLES && it_prev > 0)
+    _solver->Adapt(pow(res / res_prev, real_t(1.0) / (it - it_prev)));
+
+  // Pressures that did not converge are no base for an extrapolation
+  if (!skip) {
+    _t_p[0] = _t + dt;
+    _n_p    = (res < _epslimit) ? min(_n_p + 1, index_t(3)) : 1;
   }
   
+  // Keep the velocities of the start of the time step for the particles
+  if (_u_old) {
+    _u_old->CopyFrom(_u);
+    _v_old->CopyFrom(_v);
+  }
+
   // Compute new velocites (-> u,v)
   this->NewVelocities(dt);
 
   // Set boundary values
   _geom->Update_U(_u);
   _geom->Update_V(_v);
+
+  // Choose the sub-steps of the particle integrator from the fastest
+  // velocity at the start and the end of the time step
+  if (_u_old) {
+    const real_t cells_old = dt / min(cfl_x, cfl_y);
+    const real_t cells_new = dt * _geom->Comm()->GatherMax(
+        max(_u->AbsMax() / _geom->Mesh()[0], _v->AbsMax() / _geom->Mesh()[1]));
+    const real_t steps = ceil(max(cells_old, cells_new) / _param->ParticleCfl());
+    _substeps = index_t(max(steps, real_t(1.0)));
+  }
   
   // Compute diffusion-convection-reaction of substance
   _subst->NewConcentrations(dt, _u, _v);
@@ -246,6 +455,9 @@ bool Compute::TimeStep(int stepNr) {
   
   // Compute new time
   _t += dt;
+
+  // The derived fields are outdated now
+  _version++;
   
   if (print) {
     // Print current time
@@ -266,11 +478,14 @@ bool Compute::TimeStep(int stepNr) {
     printf("\n");
     
     // Solver stuff
-    if (it >= _param->IterMax()) {
+    if (skip) {
+      printf("  Pressure solve skipped, the RHS did not change!\n");
+    } else if (it >= _param->IterMax()) {
       printf("  DIDN'T converge! itermax reached!\n");
     } else {
       printf("  DID converge! eps (%f < %f) reached after % d iterations!\n", res, _epslimit, it);
     }
+    _solver->Report();
   }
   
   return print;
@@ -280,108 +495,434 @@ bool Compute::TimeStep(int stepNr) {
  *                            PRIVATE FUNCTIONS                            *
  ***************************************************************************/
 
-void Compute::NewVelocities(const real_t &dt){
-  InteriorIterator init(_geom);
+void Compute::Stream() {
+  const Communicator *comm = _geom->Comm();
+  const index_t nx = _geom->Size()[0];
+  const index_t ny = _geom->Size()[1];
+
+  Iterator it = Iterator(_geom);
+  
+  if (comm->IsBoundary(1)) {
+    // Init first cell with a fixed value or continue the integral of the
+    // block to the left
+    _stream->Cell(it) = 0.0;
+    comm->Receive(_stream->Data(), 1, 4);
+    it.Next();
+
+    // Calculate integral over first row in x-direction
+    while (it < nx) {
+      _stream->Cell(it) = _stream->Cell(it.Left()) - _geom->Mesh()[0] * _v->Cell(it);
+      it.Next();
+    }
+    comm->Send(_stream->Data() + nx - 2, 1, 2);
+  } else {
+    // Continue the integrals of the block below
+    comm->Receive(_stream->Data(), nx, 1);
+    it = Iterator(_geom, nx);
+  }
   
-  // Cycle to compute u,v
-  for(init.First(); init.Valid(); init.Next()){
-    if (_geom->CellTypeAt(init) == CellType::Fluid){
-      _u->Cell(init) = _F->Cell(init) - dt * _p->dx_r(init);
-      _v->Cell(init) = _G->Cell(init) - dt * _p->dy_r(init);
+  // Calculate integrals in y-direction
+  while (it.Valid()) {
+    if (_geom->CellTypeAt(it) != CellType::Obstacle) {
+      _stream->Cell(it) = _stream->Cell(it.Down()) + _geom->Mesh()[1] * _u->Cell(it);
+    } else {
+      _stream->Cell(it) = _stream->Cell(it.Down());
     }
+    it.Next();
   }
+  comm->Send(_stream->Data() + (ny - 2) * nx, nx, 3);
 }
 
-void Compute::MomentumEqu(const real_t &dt){
-  InteriorIterator init(_geom);
-  
-  // Cycle to compute F,G
-  for(init.First(); init.Valid(); init.Next()){
-    _F->Cell(init) = _u->Cell(init) + dt * (_param->InvRe() * (_u->dxx(init) + _u->dyy(init))
-                                            - _u->DC_udu_x(init, _param->Alpha())
-                                            - _u->DC_vdu_y(init, _param->Alpha(), _v)
-                                           );
-    _G->Cell(init) = _v->Cell(init) + dt * (_param->InvRe() * (_v->dxx(init) + _v->dyy(init))
-                                            - _v->DC_udv_x(init, _param->Alpha(), _u)
-                                            - _v->DC_vdv_y(init, _param->Alpha())
-                                           );
+SIMD_CLONES void Compute::NewVelocities(const real_t &dt){
+  const index_t nx = _geom->Size()[0];
+  const real_t ihx = 1.0 / _geom->Mesh()[0];
+  const real_t ihy = 1.0 / _geom->Mesh()[1];
+  const index_t *seg   = _geom->FluidSegments();
+  const index_t  n_seg = _geom->NFluidSegments();
+
+  const real_t *F = _F->Data();
+  const real_t *G = _G->Data();
+  const real_t *p = _p->Data();
+  real_t       *u = _u->Data();
+  real_t       *v = _v->Data();
+  
+  // Cycle to compute u,v segment by segment. The segments only contain fluid
+  // cells, so obstacles keep their values.
+  OMP_FOR
+  for(index_t s = 0; s < n_seg; ++s){
+    const index_t last = seg[2 * s + 1];
+    
+    SIMD_LOOP
+    for(index_t k = seg[2 * s]; k < last; ++k){
+      u[k] = F[k] - dt * ((p[k + 1] - p[k]) * ihx);
+      v[k] = G[k] - dt * ((p[k + nx] - p[k]) * ihy);
+    }
+  }
+}
+
+SIMD_CLONES void Compute::MomentumEqu(const real_t &dt){
+  const index_t nx = _geom->Size()[0];
+  const index_t ny = _geom->Size()[1];
+  const real_t alpha = _param->Alpha();
+  const real_t invRe = _param->InvRe();
+  const real_t ihx = 1.0 / _geom->Mesh()[0];
+  const real_t ihy = 1.0 / _geom->Mesh()[1];
+
+  const real_t *u = _u->Data();
+  const real_t *v = _v->Data();
+  real_t       *F = _F->Data();
+  real_t       *G = _G->Data();
+  
+  // Cycle to compute F,G row by row
+  OMP_FOR
+  for(index_t row = 1; row < ny - 1; ++row){
+    const index_t last = (row + 1) * nx - 1;
+    
+    SIMD_LOOP
+    for(index_t k = row * nx + 1; k < last; ++k){
+      // Load the stencil of both velocities once
+      const real_t uc = u[k], ul = u[k - 1], ur = u[k + 1];
+      const real_t ub = u[k - nx], ut = u[k + nx], ult = u[k - 1 + nx];
+      const real_t vc = v[k], vl = v[k - 1], vr = v[k + 1];
+      const real_t vb = v[k - nx], vt = v[k + nx], vrb = v[k + 1 - nx];
+
+      // Sums of two neighbouring velocities, i.e. twice the velocities
+      // interpolated to the edges of the control volumes of u and v
+      const real_t uu_r = uc + ur, uu_l = ul + uc;
+      const real_t uu_t = uc + ut, uu_b = ub + uc;
+      const real_t vv_t = vc + vt, vv_b = vb + vc;
+      const real_t vv_r = vc + vr, vv_l = vl + vc;
+      const real_t vv_rb = vb + vrb, uu_lt = ul + ult;
+
+      // Diffusion terms
+      const real_t lap_u = (ur + ul - uc - uc) * ihx * ihx + (ut + ub - uc - uc) * ihy * ihy;
+      const real_t lap_v = (vr + vl - vc - vc) * ihx * ihx + (vt + vb - vc - vc) * ihy * ihy;
+
+      // Convection terms with the donor cell method
+      const real_t udu_x = (0.25 * ((uu_r * uu_r - uu_l * uu_l)
+        + alpha * (fabs(uu_r) * (uc - ur) - fabs(uu_l) * (ul - uc)))) * ihx;
+      const real_t vdu_y = (0.25 * ((vv_r * uu_t - vv_rb * uu_b)
+        + alpha * (fabs(vv_r) * (uc - ut) - fabs(vv_rb) * (ub - uc)))) * ihy;
+      const real_t udv_x = (0.25 * ((vv_r * uu_t - vv_l * uu_lt)
+        + alpha * (fabs(uu_t) * (vc - vr) - fabs(uu_lt) * (vl - vc)))) * ihx;
+      const real_t vdv_y = (0.25 * ((vv_t * vv_t - vv_b * vv_b)
+        + alpha * (fabs(vv_t) * (vc - vt) - fabs(vv_b) * (vb - vc)))) * ihy;
+
+      F[k] = uc + dt * (invRe * lap_u - udu_x - vdu_y);
+      G[k] = vc + dt * (invRe * lap_v - udv_x - vdv_y);
+    }
   }
   
   _geom->Update_U(_F);
   _geom->Update_V(_G);
 }
 
-void Compute::RHS(const real_t &dt){
-  InteriorIterator init(_geom);
-  
-  // Cycle to compute rhs
-  for(init.First(); init.Valid(); init.Next()){
-    _rhs->Cell(init) = 1.0/dt * ( _F->dx_l(init) + _G->dy_l(init) );
+SIMD_CLONES void Compute::RHS(const real_t &dt){
+  const index_t nx = _geom->Size()[0];
+  const index_t ny = _geom->Size()[1];
+  const real_t idt = 1.0/dt;
+  const real_t ihx = 1.0 / _geom->Mesh()[0];
+  const real_t ihy = 1.0 / _geom->Mesh()[1];
+
+  const real_t *F   = _F->Data();
+  const real_t *G   = _G->Data();
+  real_t       *rhs = _rhs->Data();
+  
+  // Cycle to compute rhs row by row
+  OMP_FOR
+  for(index_t row = 1; row < ny - 1; ++row){
+    const index_t last = (row + 1) * nx - 1;
+    
+    SIMD_LOOP
+    for(index_t k = row * nx + 1; k < last; ++k){
+      rhs[k] = idt * ( (F[k] - F[k - 1]) * ihx + (G[k] - G[k - nx]) * ihy );
+    }
   }
 }
 
-void Compute::ComputeParticleStep(multi_real_t &particle, const real_t &dt){
-  // Get velocities at particle coordinates
-  real_t u = _u->Interpolate(particle);
-  real_t v = _v->Interpolate(particle);
-  
-  // Move particle with velocites
-  particle[0] = particle[0] + dt * u;
-  particle[1] = particle[1] + dt * v;
+void Compute::Predict(const real_t &t) {
+  // Lagrange weights of the solved pressures at the time t. Without enough
+  // history the last pressure is kept.
+  real_t w0(1.0), w1(0.0), w2(0.0);
+  const index_t order = min(_param->Predictor(), _n_p > 0 ? _n_p - 1 : 0);
+  if (order == 1) {
+    w0 = (t - _t_p[1]) / (_t_p[0] - _t_p[1]);
+    w1 = (t - _t_p[0]) / (_t_p[1] - _t_p[0]);
+  } else if (order >= 2) {
+    w0 = (t - _t_p[1]) * (t - _t_p[2]) / ((_t_p[0] - _t_p[1]) * (_t_p[0] - _t_p[2]));
+    w1 = (t - _t_p[0]) * (t - _t_p[2]) / ((_t_p[1] - _t_p[0]) * (_t_p[1] - _t_p[2]));
+    w2 = (t - _t_p[0]) * (t - _t_p[1]) / ((_t_p[2] - _t_p[0]) * (_t_p[2] - _t_p[1]));
+  }
+
+  real_t *p  = _p->Data();
+  real_t *p1 = _p_last->Data();
+  real_t *p2 = _p_prev->Data();
+
+  // The weights add up to one, so the extrapolated ghost cells still fulfil
+  // the boundary conditions
+  const index_t n = _geom->Size()[0] * _geom->Size()[1];
+  SIMD_LOOP
+  for (index_t k = 0; k < n; ++k) {
+    const real_t p0 = p[k];
+    p[k]  = w0 * p0 + w1 * p1[k] + w2 * p2[k];
+    p2[k] = p1[k];
+    p1[k] = p0;
+  }
+
+  _t_p[2] = _t_p[1];
+  _t_p[1] = _t_p[0];
 }
 
-void Compute::ComputeStreaklines(const real_t &dt, bool addOne){
-  // Cycle the list of different streaklines
-  for (list<particles_t>::iterator it_streak=_streakline.begin(); it_streak!=_streakline.end(); ++it_streak) {
-    // Cycle the list of particles
-    for (iter_particles_t it=it_streak->begin(); it!=it_streak->end(); ++it) {
-      if (this->IsValidParticle(*it)) {
-        this->ComputeParticleStep((*it), dt);
+bool Compute::SkipSolve() {
+  const index_t *seg   = _geom->FluidSegments();
+  const index_t  n_seg = _geom->NFluidSegments();
+
+  const real_t *rhs  = _rhs->Data();
+  const real_t *last = _rhs_last->Data();
+
+  // Compare the RHS of the fluid cells with the one of the last solve
+  real_t change(0.0);
+  real_t scale(0.0);
+  for (index_t s = 0; s < n_seg; ++s) {
+    for (index_t k = seg[2 * s]; k < seg[2 * s + 1]; ++k) {
+      change = max(change, real_t(fabs(rhs[k] - last[k])));
+      scale  = max(scale, real_t(fabs(last[k])));
+    }
+  }
+  change = _geom->Comm()->GatherMax(change);
+  scale  = _geom->Comm()->GatherMax(scale);
+
+  if (_n_p > 0 && change <= _param->RhsSkip() * scale)
+    return true;
+
+  _rhs_last->CopyFrom(_rhs);
+  return false;
+}
+
+void Compute::ParticleVelocities(const index_t &n, const real_t *x, const real_t *y,
+                                 const real_t &s){
+  const Communicator *comm = _geom->Comm();
+
+  _particle_vel.resize(4 * n);
+  real_t *u = _particle_vel.data();
+  real_t *v = u + n;
+
+  real_t *u_old = (s > 0.0) ? v + n : u;
+  real_t *v_old = u_old + n;
+
+  // The particles are interpolated in chunks, each thread handles its own
+  const index_t chunks = (n + PARTICLE_CHUNK - 1) / PARTICLE_CHUNK;
+  OMP_FOR
+  for (index_t c = 0; c < chunks; ++c) {
+    const index_t first = c * PARTICLE_CHUNK;
+    const index_t last  = min(n, first + PARTICLE_CHUNK);
+    const index_t m     = last - first;
+
+    // Get velocities at particle coordinates. In between the start and the
+    // end of the time step both are interpolated, the old ones behind the new.
+    if (s > 0.0) {
+      _u->Interpolate(m, x + first, y + first, u + first);
+      _v->Interpolate(m, x + first, y + first, v + first);
+    }
+    if (s < 1.0) {
+      _u_old->Interpolate(m, x + first, y + first, u_old + first);
+      _v_old->Interpolate(m, x + first, y + first, v_old + first);
+
+      for (index_t i = first; s > 0.0 && i < last; ++i) {
+        u[i] = u_old[i] + s * (u[i] - u_old[i]);
+        v[i] = v_old[i] + s * (v[i] - v_old[i]);
       }
     }
-    
-    // Add new item, if desired
-    if (addOne){
-      multi_real_t lastStep = *(--it_streak->end());
-      
-      if (!this->IsValidParticle(lastStep))
-        continue;
-      
-      this->ComputeParticleStep(lastStep, dt);
-      it_streak->push_back(lastStep);
+
+    // Only the block containing a particle keeps its velocity, the others
+    // contribute zero to the sum
+    for (index_t i = first; comm->ThreadCnt() > 1 && i < last; ++i) {
+      if (!this->IsOwnParticle(multi_real_t(x[i], y[i])))
+        u[i] = v[i] = 0.0;
     }
   }
+
+  if (comm->ThreadCnt() > 1)
+    comm->GatherSum(u, 2 * n);
 }
 
-void Compute::ComputeParticleTracing(const real_t &dt, bool addOne){
-  // Cycle the list of different streaklines
-  for (list<particles_t>::iterator it_trace=_trace.begin(); it_trace!=_trace.end(); ++it_trace) {
-    // Get last known position of the particle to trace
-    multi_real_t lastStep = *(--it_trace->end());
-    
-    if (!this->IsValidParticle(lastStep))
+void Compute::Advect(const index_t &n, const real_t *x, const real_t *y, const real_t &dt){
+  _particle_pos.assign(x, x + n);
+  _particle_pos.insert(_particle_pos.end(), y, y + n);
+  real_t *pos = _particle_pos.data();
+
+  // Explicit Euler with the velocities at the end of the time step
+  if (!_u_old) {
+    this->ParticleVelocities(n, pos, pos + n, 1.0);
+    const real_t *vel = _particle_vel.data();
+    OMP_FOR
+    for (index_t i = 0; i < 2 * n; ++i)
+      pos[i] = pos[i] + dt * vel[i];
+    return;
+  }
+
+  // The positions and velocities are stored as x followed by y, so each
+  // update is a single loop over both coordinates
+  _particle_stage.resize(2 * n);
+  _particle_sum.resize(2 * n);
+  real_t *stage = _particle_stage.data();
+  real_t *sum   = _particle_sum.data();
+  const real_t h = dt / _substeps;
+
+  for (index_t step = 0; step < _substeps; ++step) {
+    // Fractions of the time step at the start, middle and end of the sub-step
+    const real_t s0 = real_t(step) / _substeps;
+    const real_t sm = (step + 0.5) / _substeps;
+    const real_t s1 = real_t(step + 1) / _substeps;
+
+    // All stages interpolate n particles, so vel stays valid between them
+    this->ParticleVelocities(n, pos, pos + n, s0);
+    const real_t *vel = _particle_vel.data();
+    OMP_FOR
+    for (index_t i = 0; i < 2 * n; ++i) {
+      sum[i]   = vel[i];
+      stage[i] = pos[i] + 0.5 * h * vel[i];
+    }
+    this->ParticleVelocities(n, stage, stage + n, sm);
+
+    // Midpoint rule
+    if (_param->Integrator() == 2) {
+      OMP_FOR
+      for (index_t i = 0; i < 2 * n; ++i)
+        pos[i] = pos[i] + h * vel[i];
       continue;
-    
-    // Update position
-    this->ComputeParticleStep(lastStep, dt);
-    
-    if (addOne) {
-      // Save updated position
-      it_trace->push_back(lastStep);
-    } else {
-      // Replace last element
-      it_trace->erase(--it_trace->end());
-      it_trace->push_back(lastStep);
     }
+
+    // Classical Runge-Kutta scheme
+    OMP_FOR
+    for (index_t i = 0; i < 2 * n; ++i) {
+      sum[i]  += 2.0 * vel[i];
+      stage[i] = pos[i] + 0.5 * h * vel[i];
+    }
+    this->ParticleVelocities(n, stage, stage + n, sm);
+    OMP_FOR
+    for (index_t i = 0; i < 2 * n; ++i) {
+      sum[i]  += 2.0 * vel[i];
+      stage[i] = pos[i] + h * vel[i];
+    }
+    this->ParticleVelocities(n, stage, stage + n, s1);
+    OMP_FOR
+    for (index_t i = 0; i < 2 * n; ++i)
+      pos[i] = pos[i] + h / 6.0 * (sum[i] + vel[i]);
+  }
+}
+
+void Compute::MoveHeads(Particles *lines, const real_t &dt, const bool &addOne){
+  // Collect the heads of the active lines
+  std::vector<index_t> line;
+  for (index_t l = 0; l < lines->Lines(); ++l) {
+    if (lines->Active(l))
+      line.push_back(l);
+  }
+
+  const index_t n = line.size();
+  std::vector<index_t> head(n);
+  std::vector<real_t>  x(n), y(n);
+  OMP_FOR
+  for (index_t i = 0; i < n; ++i) {
+    head[i] = lines->Head(line[i]);
+    x[i]    = lines->X()[head[i]];
+    y[i]    = lines->Y()[head[i]];
   }
+
+  // Move particle with velocites
+  this->Advect(n, x.data(), y.data(), dt);
+  const real_t *px = _particle_pos.data();
+  const real_t *py = px + n;
+
+  std::vector<char> valid(n);
+  OMP_FOR
+  for (index_t i = 0; i < n; ++i)
+    valid[i] = this->IsValidParticle(px[i], py[i]);
+
+  // Save updated positions in the order of the lines
+  if (addOne) {
+    lines->Append(n, line.data(), px, py, valid.data());
+    return;
+  }
+
+  // Replace last element
+  real_t *hx = lines->X();
+  real_t *hy = lines->Y();
+  char   *ha = lines->Alive();
+  OMP_FOR
+  for (index_t i = 0; i < n; ++i) {
+    hx[head[i]] = px[i];
+    hy[head[i]] = py[i];
+    ha[head[i]] = valid[i];
+  }
+}
+
+void Compute::ComputeStreaklines(const real_t &dt, bool addOne){
+  real_t *x     = _streakline.X();
+  real_t *y     = _streakline.Y();
+  char   *alive = _streakline.Alive();
+  const index_t n = _streakline.Size();
+
+  // Move all particles of all streaklines. Particles leaving the domain stop
+  // and are removed below.
+  this->Advect(n, x, y, dt);
+  const real_t *px = _particle_pos.data();
+  const real_t *py = px + n;
+
+  index_t died = 0;
+  OMP_FOR_REDUCE(+, died)
+  for (index_t i = 0; i < n; ++i) {
+    if (!alive[i]) continue;
+
+    x[i] = px[i];
+    y[i] = py[i];
+    alive[i] = this->IsValidParticle(x[i], y[i]);
+    died += !alive[i];
+  }
+
+  // Add new item, if desired. It starts one step ahead of the head of its
+  // streakline.
+  if (addOne)
+    this->MoveHeads(&_streakline, dt, true);
+
+  if (died > 0)
+    _streakline.Compact();
+}
+
+void Compute::ComputeParticleTracing(const real_t &dt, bool addOne){
+  // Only the head of each trace moves, the other particles are its previous
+  // positions. These are kept, so the previous head stops moving.
+  const index_t n = _trace.Size();
+  this->MoveHeads(&_trace, dt, addOne);
+
+  for (index_t i = 0; addOne && i < n; ++i)
+    _trace.Alive()[i] = 0;
+}
+
+bool Compute::IsOwnParticle(const multi_real_t &particle) const{
+  const multi_index_t &offset = _geom->Offset();
+  const multi_index_t &size   = _geom->Size();
+
+  // Cell containing the particle in global indices, clamped to the domain
+  for (index_t dim = 0; dim < DIM; ++dim) {
+    const real_t cell = floor(particle[dim] / _geom->Mesh()[dim]) + 1;
+    const real_t last = _geom->TotalSize()[dim] - 2;
+    const real_t pos  = min(last, max(real_t(1.0), cell));
+
+    if (pos < offset[dim] + 1 || pos > offset[dim] + size[dim] - 2)
+      return false;
+  }
+
+  return true;
 }
 
-bool Compute::IsValidParticle(multi_real_t &particle){
+bool Compute::IsValidParticle(const real_t &x, const real_t &y) const{
   if (
-      (particle[0] < 0.0) ||
-      (particle[0] > 1.001*_geom->Length()[0]) ||
-      (particle[1] < 0.0) ||
-      (particle[1] > 1.001*_geom->Length()[1])
+      (x < 0.0) ||
+      (x > 1.001*_geom->Length()[0]) ||
+      (y < 0.0) ||
+      (y > 1.001*_geom->Length()[1])
      ){
     return false;
   }else{
@@ -17,6 +17,7 @@
 
 #include "typedef.hpp"
 #include "substance.hpp"
+#include "particles.hpp"
 //------------------------------------------------------------------------------
 #ifndef __COMPUTE_HPP
 #define __COMPUTE_HPP
@@ -65,30 +66,56 @@ public:
   //   equation.
   const Grid *GetRHS() const;
 
-  /// Computes and returns the absolute velocity (u_x + u_y)^(1/2) on a grid.
+  /// Returns the absolute velocity (u_x + u_y)^(1/2) on a grid. It is only
+  /// computed on the first request after a time step.
   //
   // @return Grid A grid containing the absolute velocities.
   const Grid *GetVelocity();
 
-  /// Computes and returns the vorticity on a grid.
+  /// Returns the vorticity on a grid. It is only computed on the first request
+  /// after a time step.
   //
   // @return Grid A grid containing the vorticity.
   const Grid *GetVorticity();
 
-  /// Computes and returns the stream line values on a grid.
+  /// Returns the stream line values on a grid. They are only computed on the
+  /// first request after a time step.
   //
   // @return Grid A grid containing the stream lines.
   const Grid *GetStream();
+
+  /// Computes the requested derived fields that are outdated. The absolute
+  /// velocity and the vorticity are computed in a single pass, so requesting
+  /// them together is cheaper than one after another. In parallel runs all
+  /// processes have to request the same fields, as the vorticity and the
+  /// stream function exchange values between the blocks.
+  //
+  // @see Enum DerivedField
+  // @param fields index_t The requested fields combined by bitwise or
+  void UpdateDerived(const index_t &fields);
   
   /// Returns the position of the traced particles.
   //
-  // @return list<real_t> A list containing the traced particles at the current timestep.
-  list<particles_t> *GetParticleTracing();
+  // @return Particles The traced particles at the current timestep, one line per trace.
+  const Particles *GetParticleTracing() const;
   
   /// Returns the position of the streakline particles.
   //
-  // @return list<real_t> A list containing the particles of a streakline at the current timestep.
-  list<particles_t> *GetStreaklines();
+  // @return Particles The particles of the streaklines at the current timestep.
+  const Particles *GetStreaklines() const;
+
+  /// Writes the state of the simulation to a checkpoint: the time, the
+  /// velocities, the pressure and the particles. All other fields are
+  /// recomputed from these in the next time step.
+  //
+  // @param handle FILE* The opened checkpoint file
+  void WriteCheckpoint(FILE *handle) const;
+
+  /// Restores the state written by WriteCheckpoint, so the following time
+  /// steps reproduce the run the checkpoint was taken from.
+  //
+  // @param handle FILE* The opened checkpoint file
+  void ReadCheckpoint(FILE *handle);
 
 private:
   /// _t real_t The current timestep
@@ -139,6 +166,50 @@ private:
   /// _vort Grid Contains the vorticity values
   Grid *_vort;
 
+  /// _p_last Grid The pressure of the time step before _p; NULL without
+  ///   pressure predictor
+  Grid *_p_last;
+
+  /// _p_prev Grid The pressure of the time step before _p_last; NULL without
+  ///   pressure predictor
+  Grid *_p_prev;
+
+  /// _t_p real_t[3] The times of the pressures in _p, _p_last and _p_prev
+  real_t _t_p[3];
+
+  /// _n_p index_t The number of solved pressures in _p, _p_last and _p_prev
+  index_t _n_p;
+
+  /// _rhs_last Grid The RHS of the last pressure solve; NULL if every time
+  ///   step solves
+  Grid *_rhs_last;
+
+  /// _u_old Grid The u velocities at the start of the time step; NULL for
+  ///   the Euler particle integrator
+  Grid *_u_old;
+
+  /// _v_old Grid The v velocities at the start of the time step; NULL for
+  ///   the Euler particle integrator
+  Grid *_v_old;
+
+  /// _substeps index_t The number of sub-steps of the particle integrator in
+  ///   the current time step
+  index_t _substeps;
+
+  /// _version index_t Counts the changes of the velocities. Incremented by
+  ///   each time step and by restoring a checkpoint.
+  index_t _version;
+
+  /// _version_velocity index_t The _version the absolute velocity in _tmp
+  ///   was computed for
+  index_t _version_velocity;
+
+  /// _version_vort index_t The _version _vort was computed for
+  index_t _version_vort;
+
+  /// _version_stream index_t The _version _stream was computed for
+  index_t _version_stream;
+
   /// _solver Solver The solver used for iteratively calculating the
   /// values for the next timestep.
   Solver *_solver;
@@ -152,18 +223,37 @@ private:
   /// _subst Substance Holds substance information and calculation
   const Substance *_subst;
   
-  // _streakline particles_t List to hold position of particles for streaklines
-  list<particles_t> _streakline;
+  // _streakline Particles The particles of the streaklines, one line per
+  // streakline
+  Particles _streakline;
   
-  // _trace particles_t List to hold position of particles for particle tracing
-  list<particles_t> _trace;
+  // _trace Particles The positions of the traced particles, one line per
+  // particle. The head of each line is the current position.
+  Particles _trace;
+
+  // _particle_vel vector<real_t> The velocities u of the particles passed to
+  // ParticleVelocities, followed by their velocities v
+  std::vector<real_t> _particle_vel;
+
+  // _particle_pos vector<real_t> The x coordinates of the particles moved by
+  // Advect, followed by their y coordinates
+  std::vector<real_t> _particle_pos;
+
+  // _particle_stage vector<real_t> The positions of the particles at an
+  // intermediate stage of the Runge-Kutta schemes
+  std::vector<real_t> _particle_stage;
+
+  // _particle_sum vector<real_t> The weighted sum of the velocities of the
+  // stages of the classical Runge-Kutta scheme
+  std::vector<real_t> _particle_sum;
 
   /// Compute the new velocites u & v.
   //
   // @param dt real_t The timestep dt
   void NewVelocities(const real_t &dt);
 
-  /// Compute the temporary velocites F & G.
+  /// Compute the temporary velocites F & G. Both are computed in one pass,
+  /// loading the u and v stencil of a cell only once.
   //
   // @param dt real_t The timestep dt
   void MomentumEqu(const real_t &dt);
@@ -173,11 +263,53 @@ private:
   // @param dt real_t The timestep dt
   void RHS(const real_t &dt);
   
-  /// Compute the new position of a particle.
+  /// Extrapolates the pressures of the last time steps to the given time as
+  /// initial guess of the solver and moves them back in the history.
+  //
+  // @param t real_t The time of the next pressure
+  void Predict(const real_t &t);
+
+  /// Returns whether the RHS differs from the one of the last pressure solve
+  /// by less than the threshold, so the pressure is still valid. Otherwise
+  /// the RHS is remembered for the next comparison.
+  //
+  // @return bool True if the pressure solve can be skipped
+  bool SkipSolve();
+
+  /// Integrates the velocities to the stream function. Each block continues
+  /// the integral of the blocks to the left and below.
+  void Stream();
+  
+  /// Interpolates the velocities at the given particles into _particle_vel.
+  /// All particles are handled at once, so a parallel run sums the
+  /// contributions of the blocks in a single exchange. Between the start and
+  /// the end of the time step the velocities are interpolated linearly in
+  /// time.
   //
-  // @param particle multi_real_t The coordinates of the particle to move
+  // @param n index_t The number of particles
+  // @param x real_t* The x coordinates of the particles
+  // @param y real_t* The y coordinates of the particles
+  // @param s real_t The fraction of the time step, 0 for the velocities at
+  //   its start and 1 for those at its end
+  void ParticleVelocities(const index_t &n, const real_t *x, const real_t *y,
+                          const real_t &s);
+
+  /// Moves the given particles by one time step into _particle_pos with the
+  /// selected integrator. The Runge-Kutta schemes take _substeps steps.
+  //
+  // @param n index_t The number of particles
+  // @param x real_t* The x coordinates of the particles
+  // @param y real_t* The y coordinates of the particles
+  // @param dt real_t The timestep dt
+  void Advect(const index_t &n, const real_t *x, const real_t *y, const real_t &dt);
+
+  /// Moves the heads of all active lines by one time step. With addOne the
+  /// new positions are appended as new heads, otherwise they replace them.
+  //
+  // @param lines Particles The lines whose heads are moved
   // @param dt real_t The timestep dt
-  void ComputeParticleStep(multi_real_t &particle, const real_t &dt);
+  // @param addOne bool Whether the heads are appended
+  void MoveHeads(Particles *lines, const real_t &dt, const bool &addOne);
   
   /// Compute the new position of the streakline particles.
   //
@@ -191,9 +323,17 @@ private:
   
   /// Returns boolean, whether given particle lays inside the simulated area
   ///
-  /// @param multi_real_t The particle to be checked
+  /// @param x real_t The x coordinate of the particle to be checked
+  /// @param y real_t The y coordinate of the particle to be checked
   /// @return bool Tells whether the given particle lays inside the simulated area
-  bool IsValidParticle(multi_real_t &particle);
+  bool IsValidParticle(const real_t &x, const real_t &y) const;
+
+  /// Returns boolean, whether given particle lays inside the block of this
+  /// process. Particles outside of the domain belong to the nearest block.
+  ///
+  /// @param multi_real_t The particle to be checked
+  /// @return bool Tells whether this process computes the particle velocity
+  bool IsOwnParticle(const multi_real_t &particle) const;
 };
 //------------------------------------------------------------------------------
 #endif // __COMPUTE_HPP
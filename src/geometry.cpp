@@ -2,13 +2,17 @@
 #include "geometry.hpp"
 
 #include "grid.hpp"
+#include "communicator.hpp"
 
 #include <cstdio>  // file methods
 #include <cstring> // string
 #include <cstdlib> // read/write
 #include <cmath>   // pow
 
-Geometry::Geometry(){
+/// Communicator of geometries that are not decomposed
+static const Communicator serial_comm;
+
+Geometry::Geometry() : _comm(&serial_comm), _obstacles(false){
   // Init number of cells in each dimension
   _size[0] = 10;
   _size[1] = 10;
@@ -32,6 +36,11 @@ Geometry::Geometry(){
   // for free geometries
   _baked_neighbors = new int[_size[0] * _size[1]];
 
+  _segments   = NULL;
+  _n_segments = 0;
+
+  _total_size = _size;
+
   this->Recalculate();
 }
 
@@ -39,6 +48,7 @@ Geometry::~Geometry() {
   delete[] _cells;
   delete[] _nb;
   delete[] _baked_neighbors;
+  delete[] _segments;
 }
 
 void Geometry::Load(const char *file){
@@ -92,14 +102,14 @@ void Geometry::Load(const char *file){
 
     if (strcmp(name, "trace") == 0) {
       if (fscanf(handle, " %lf %lf\n", &inval[0], &inval[1])) {
-        _trace.push_back(multi_real_t({inval[0], inval[1]}));
+        _trace.push_back(multi_real_t({real_t(inval[0]), real_t(inval[1])}));
       }
       continue;
     }
     
     if (strcmp(name, "streakline") == 0) {
       if (fscanf(handle, " %lf %lf\n", &inval[0], &inval[1])) {
-        _streakline.push_back(multi_real_t({inval[0], inval[1]}));
+        _streakline.push_back(multi_real_t({real_t(inval[0]), real_t(inval[1])}));
       }
       continue;
     }
@@ -145,8 +155,44 @@ void Geometry::Load(const char *file){
 
   fclose(handle);
 
+  _total_size = _size;
+
   this->Recalculate();
   this->BakeNeighbors();
+  this->BakeSegments();
+  this->BakePlans();
+}
+
+void Geometry::Decompose(Communicator *comm) {
+  comm->Decompose(multi_index_t(_total_size[0] - 2, _total_size[1] - 2));
+
+  _comm   = comm;
+  _offset = comm->BlockOffset();
+  _obstacles = !this->ObstacleFree();
+
+  const multi_index_t size(comm->BlockSize()[0] + 2, comm->BlockSize()[1] + 2);
+
+  // Cut the own block including the ghost cells out of the global fields
+  char *cells = new char[size[0] * size[1]];
+  int  *baked = new int[size[0] * size[1]];
+
+  for (index_t j = 0; j < size[1]; ++j) {
+    for (index_t i = 0; i < size[0]; ++i) {
+      const index_t global = (j + _offset[1]) * _total_size[0] + i + _offset[0];
+      cells[j * size[0] + i] = _cells[global];
+      baked[j * size[0] + i] = _baked_neighbors[global];
+    }
+  }
+
+  delete[] _cells;
+  delete[] _baked_neighbors;
+
+  _cells = cells;
+  _baked_neighbors = baked;
+  _size = size;
+
+  this->BakeSegments();
+  this->BakePlans();
 }
 
 void Geometry::Recalculate() {
@@ -163,6 +209,18 @@ const multi_index_t &Geometry::Size() const {
   return _size;
 }
 
+const multi_index_t &Geometry::TotalSize() const {
+  return _total_size;
+}
+
+const multi_index_t &Geometry::Offset() const {
+  return _offset;
+}
+
+const Communicator *Geometry::Comm() const {
+  return _comm;
+}
+
 const multi_real_t &Geometry::Mesh() const {
   return _h;
 }
@@ -192,71 +250,200 @@ void Geometry::BakeNeighbors() {
   }
 }
 
-void Geometry::Update_U(Grid *u) const{
+void Geometry::BakeSegments() {
+  // Count the segments first, then store their bounds
+  for (index_t pass = 0; pass < 2; ++pass) {
+    index_t n(0);
+
+    for (index_t j = 1; j < _size[1] - 1; ++j) {
+      const index_t end = (j + 1) * _size[0] - 1;
+
+      for (index_t k = j * _size[0] + 1; k < end; ++k) {
+        if (_cells[k] != CellType::Fluid)
+          continue;
+
+        const index_t first = k;
+        while (k < end && _cells[k] == CellType::Fluid)
+          ++k;
+
+        if (pass == 1) {
+          _segments[2 * n]     = first;
+          _segments[2 * n + 1] = k;
+        }
+        ++n;
+      }
+    }
+
+    if (pass == 0) {
+      delete[] _segments;
+      _segments   = new index_t[2 * n];
+      _n_segments = n;
+    }
+  }
+}
+
+void Geometry::BakePlans() {
+  _boundary_u.Clear();
+  _boundary_v.Clear();
+  _boundary_p.Clear();
+  _obstacle_u.Clear();
+  _obstacle_v.Clear();
+  _obstacle_p.Clear();
+
+  // Set the left, right, lower and upper boundary, if they belong to the
+  // domain boundary
+  const index_t sides[4] = {4, 2, 1, 3};
   BoundaryIterator boit(this, 1);
+
+  for (index_t s = 0; s < 4; ++s) {
+    if (!_comm->IsBoundary(sides[s])) continue;
+
+    boit.SetBoundary(sides[s]);
+    this->CycleBoundary_U(&_boundary_u, boit);
+    this->CycleBoundary_V(&_boundary_v, boit);
+    this->CycleBoundary_P(&_boundary_p, boit);
+  }
   
-  // Set left boundary
-  boit.SetBoundary(4);
-  this->CycleBoundary_U(u, boit);
+  // Set corners of the domain to avg of neighbour cells
+  if (_comm->IsBoundary(1) && _comm->IsBoundary(4)) {
+    Iterator cbl = boit.CornerBottomLeft();
+    _boundary_p.Average(cbl, cbl.Right(), cbl.Top(), 0.5);
+  }
   
-  // Set right boundary
-  boit.SetBoundary(2);
-  this->CycleBoundary_U(u, boit);
-    
-  // Set lower boundary
-  boit.SetBoundary(1);
-  this->CycleBoundary_U(u, boit);
+  if (_comm->IsBoundary(1) && _comm->IsBoundary(2)) {
+    Iterator cbr = boit.CornerBottomRight();
+    _boundary_p.Average(cbr, cbr.Left(), cbr.Top(), 0.5);
+  }
   
-  // Set upper boundary
-  boit.SetBoundary(3);
-  this->CycleBoundary_U(u, boit);
+  if (_comm->IsBoundary(3) && _comm->IsBoundary(4)) {
+    Iterator ctl = boit.CornerTopLeft();
+    _boundary_p.Average(ctl, ctl.Right(), ctl.Down(), 0.5);
+  }
   
+  if (_comm->IsBoundary(3) && _comm->IsBoundary(2)) {
+    Iterator ctr = boit.CornerTopRight();
+    _boundary_p.Average(ctr, ctr.Left(), ctr.Down(), 0.5);
+  }
+
   ObstacleIterator oit = ObstacleIterator(this);
 
   for(; oit.Valid(); oit.Next()) {
     switch (_baked_neighbors[oit]) {
       case 13:
-        u->Cell(oit) = -u->Cell(oit.Top());
+        _obstacle_u.Linear(oit, oit.Top(), -1.0, 0.0);
+        _obstacle_v.Constant(oit, 0.0);
+        _obstacle_p.Linear(oit, oit.Top(), 1.0, 0.0);
         break;
-        
+
       case 14:
-        u->Cell(oit) = 0;
-        u->Cell(oit.Left()) = 0;
+        _obstacle_u.Constant(oit, 0.0);
+        _obstacle_u.Constant(oit.Left(), 0.0);
+        _obstacle_v.Linear(oit, oit.Left(), -1.0, 0.0);
+        _obstacle_p.Linear(oit, oit.Left(), 1.0, 0.0);
         break;
 
       case 11:
-      case 3:
-      case 9:
-        u->Cell(oit) = 0;
+        _obstacle_u.Constant(oit, 0.0);
+        _obstacle_v.Linear(oit, oit.Right(), -1.0, 0.0);
+        _obstacle_p.Linear(oit, oit.Right(), 1.0, 0.0);
         break;
 
       case 7:
-        u->Cell(oit) = -u->Cell(oit.Down());
+        _obstacle_u.Linear(oit, oit.Down(), -1.0, 0.0);
+        _obstacle_v.Constant(oit, 0.0);
+        _obstacle_v.Constant(oit.Down(), 0.0);
+        _obstacle_p.Linear(oit, oit.Down(), 1.0, 0.0);
+        break;
+
+      case 3:
+        _obstacle_u.Constant(oit, 0.0);
+        _obstacle_v.Linear(oit, oit.Right(), -1.0, 0.0);
+        _obstacle_v.Constant(oit.Down(), 0.0);
+        _obstacle_p.Average(oit, oit.Right(), oit.Down(), 0.5);
+        break;
+
+      case 9:
+        _obstacle_u.Constant(oit, 0.0);
+        _obstacle_v.Constant(oit, 0.0);
+        _obstacle_p.Average(oit, oit.Right(), oit.Top(), 0.5);
         break;
 
       case 12:
-        u->Cell(oit) = -u->Cell(oit.Top());
-        u->Cell(oit.Left()) = 0;
+        _obstacle_u.Linear(oit, oit.Top(), -1.0, 0.0);
+        _obstacle_u.Constant(oit.Left(), 0.0);
+        _obstacle_v.Constant(oit, 0.0);
+        _obstacle_p.Average(oit, oit.Left(), oit.Top(), 0.5);
         break;
 
       case 6:
-        u->Cell(oit) = -u->Cell(oit.Down());
-        u->Cell(oit.Left()) = 0;
+        _obstacle_u.Linear(oit, oit.Down(), -1.0, 0.0);
+        _obstacle_u.Constant(oit.Left(), 0.0);
+        _obstacle_v.Linear(oit, oit.Left(), -1.0, 0.0);
+        _obstacle_v.Constant(oit.Down(), 0.0);
+        _obstacle_p.Average(oit, oit.Left(), oit.Down(), 0.5);
         break;
     }
   }
+
+  // Obstacles in the first column of the right neighbour set the velocity
+  // on their left face, which is stored in this block
+  if (!_comm->IsBoundary(2)) {
+    for (index_t j = 1; j < _size[1] - 1; ++j) {
+      const index_t k = (j + 1) * _size[0] - 1;
+      if (_cells[k] == CellType::Fluid) continue;
+
+      switch (_baked_neighbors[k]) {
+        case 14:
+        case 12:
+        case 6:
+          _obstacle_u.Constant(k - 1, 0.0);
+          break;
+      }
+    }
+  }
+
+  // Obstacles in the first row of the upper neighbour set the velocity on
+  // their lower face, which is stored in this block
+  if (!_comm->IsBoundary(3)) {
+    for (index_t i = 1; i < _size[0] - 1; ++i) {
+      const index_t k = (_size[1] - 1) * _size[0] + i;
+      if (_cells[k] == CellType::Fluid) continue;
+
+      switch (_baked_neighbors[k]) {
+        case 7:
+        case 3:
+        case 6:
+          _obstacle_v.Constant(k - _size[0], 0.0);
+          break;
+      }
+    }
+  }
 }
 
-void Geometry::CycleBoundary_U(Grid *u, BoundaryIterator boit) const{
-  real_t y = -0.5*_h[1];
+void Geometry::Update_U(Grid *u) const{
+  _boundary_u.Apply(u);
+
+  // Get the ghost cells of the other sides from the neighbouring blocks
+  _comm->CopyBoundary(u);
+
+  _obstacle_u.Apply(u);
+
+  // Pass the values next to obstacles on to the neighbouring blocks
+  if (_obstacles) _comm->CopyBoundary(u);
+}
+
+void Geometry::CycleBoundary_U(BoundaryPlan *plan, BoundaryIterator boit) const{
+  // The parabolic profile is evaluated at the global y coordinate, which
+  // starts below the first ghost cell of blocks above the lower boundary
+  real_t y = _comm->IsBoundary(1) ? -0.5*_h[1] : (_offset[1] - 1.5)*_h[1];
   for (; boit.Valid(); boit.Next())
     switch(this->CellTypeAt(boit)){
       case CellType::Obstacle:
-        this->SetUDirichlet(u, boit, 0.0);
+        this->SetUDirichlet(plan, boit, 0.0);
         break;
         
       case CellType::Inflow:
-        this->SetUDirichlet(u, boit, _velocity[0]);
+        this->SetUDirichlet(plan, boit, _velocity[0]);
         break;
         
       case CellType::H_Inflow:
@@ -265,19 +452,19 @@ void Geometry::CycleBoundary_U(Grid *u, BoundaryIterator boit) const{
         
       case CellType::V_Inflow:
         if ((boit.Boundary() == 4)){
-          this->SetUParabol(u, boit, _velocity[0], y);
+          this->SetUParabol(plan, boit, _velocity[0], y);
         }else{
           throw std::runtime_error(std::string("Not implemented!"));
         }
         break;
         
       case CellType::Outflow:
-        this->SetUNeumann(u, boit, 0.0);
+        this->SetUNeumann(plan, boit, 0.0);
         break;
         
       case CellType::V_Slip:
         if ((boit.Boundary() == 2) || (boit.Boundary() == 4)){
-          this->SetUNeumann(u, boit, 0.0);
+          this->SetUNeumann(plan, boit, 0.0);
         }else{
           throw std::runtime_error(std::string("Vertical slip condition is not allowed on the lower/upper boundary"));
         }
@@ -285,7 +472,7 @@ void Geometry::CycleBoundary_U(Grid *u, BoundaryIterator boit) const{
         
       case CellType::H_Slip:
         if ((boit.Boundary() == 1) || (boit.Boundary() == 3)){
-          this->SetUNeumann(u, boit, 0.0);
+          this->SetUNeumann(plan, boit, 0.0);
         }else{
           throw std::runtime_error(std::string("Horizontal slip condition is not allowed on the left/right boundary"));
         }
@@ -298,69 +485,26 @@ void Geometry::CycleBoundary_U(Grid *u, BoundaryIterator boit) const{
 }
 
 void Geometry::Update_V(Grid *v) const{
-  BoundaryIterator boit(this, 1);
-  
-  // Set left boundary
-  boit.SetBoundary(4);
-  this->CycleBoundary_V(v, boit);
-  
-  // Set right boundary
-  boit.SetBoundary(2);
-  this->CycleBoundary_V(v, boit);
-    
-  // Set lower boundary
-  boit.SetBoundary(1);
-  this->CycleBoundary_V(v, boit);
-  
-  // Set upper boundary
-  boit.SetBoundary(3);
-  this->CycleBoundary_V(v, boit);
-  
-  ObstacleIterator oit = ObstacleIterator(this);
-
-  for(; oit.Valid(); oit.Next()) {
-    switch (_baked_neighbors[oit]) {
-      case 7:
-        v->Cell(oit) = 0;
-        v->Cell(oit.Down()) = 0;
-        break;
-        
-      case 13:
-      case 9:
-      case 12:
-        v->Cell(oit) = 0;
-        break;
+  _boundary_v.Apply(v);
 
-      case 11:
-        v->Cell(oit) = -v->Cell(oit.Right());
-        break;
+  // Get the ghost cells of the other sides from the neighbouring blocks
+  _comm->CopyBoundary(v);
 
-      case 14:
-        v->Cell(oit) = -v->Cell(oit.Left());
-        break;
+  _obstacle_v.Apply(v);
 
-      case 3:
-        v->Cell(oit) = -v->Cell(oit.Right());
-        v->Cell(oit.Down()) = 0;
-        break;
-
-      case 6:
-        v->Cell(oit) = -v->Cell(oit.Left());
-        v->Cell(oit.Down()) = 0;
-        break;
-    }
-  }
+  // Pass the values next to obstacles on to the neighbouring blocks
+  if (_obstacles) _comm->CopyBoundary(v);
 }
 
-void Geometry::CycleBoundary_V(Grid *v, BoundaryIterator boit) const{
+void Geometry::CycleBoundary_V(BoundaryPlan *plan, BoundaryIterator boit) const{
   for (; boit.Valid(); boit.Next())
     switch(this->CellTypeAt(boit)){
       case CellType::Obstacle:
-        this->SetVDirichlet(v, boit, 0.0);
+        this->SetVDirichlet(plan, boit, 0.0);
         break;
         
       case CellType::Inflow:
-        this->SetVDirichlet(v, boit, _velocity[1]);
+        this->SetVDirichlet(plan, boit, _velocity[1]);
         break;
         
       case CellType::H_Inflow:
@@ -369,19 +513,19 @@ void Geometry::CycleBoundary_V(Grid *v, BoundaryIterator boit) const{
         
       case CellType::V_Inflow:
         if ((boit.Boundary() == 2) || (boit.Boundary() == 4)){
-          this->SetVDirichlet(v, boit, 0.0);
+          this->SetVDirichlet(plan, boit, 0.0);
         }else{
           throw std::runtime_error(std::string("Vertical slip condition is not allowed on the lower/upper boundary"));
         }
         break;
         
       case CellType::Outflow:
-        this->SetVNeumann(v, boit, 0.0);
+        this->SetVNeumann(plan, boit, 0.0);
         break;
         
       case CellType::V_Slip:
         if ((boit.Boundary() == 2) || (boit.Boundary() == 4)){
-          this->SetVNeumann(v, boit, 0.0);
+          this->SetVNeumann(plan, boit, 0.0);
         }else{
           throw std::runtime_error(std::string("Vertical slip condition is not allowed on the lower/upper boundary"));
         }
@@ -389,7 +533,7 @@ void Geometry::CycleBoundary_V(Grid *v, BoundaryIterator boit) const{
         
       case CellType::H_Slip:
         if ((boit.Boundary() == 1) || (boit.Boundary() == 3)){
-          this->SetVNeumann(v, boit, 0.0);
+          this->SetVNeumann(plan, boit, 0.0);
         }else{
           throw std::runtime_error(std::string("Horizontal slip condition is not allowed on the left/right boundary"));
         }
@@ -402,84 +546,26 @@ void Geometry::CycleBoundary_V(Grid *v, BoundaryIterator boit) const{
 }
 
 void Geometry::Update_P(Grid *p) const{
-  BoundaryIterator boit(this, 1);
-  
-  // Set left boundary
-  boit.SetBoundary(4);
-  this->CycleBoundary_P(p, boit);
-  
-  // Set right boundary
-  boit.SetBoundary(2);
-  this->CycleBoundary_P(p, boit);
-  
-  // Set lower boundary
-  boit.SetBoundary(1);
-  this->CycleBoundary_P(p, boit);
-  // Set upper boundary
-  boit.SetBoundary(3);
-  this->CycleBoundary_P(p, boit);
-  
-  // Set corners to avg of neighbour cells
-  Iterator cbl = boit.CornerBottomLeft();
-  p->Cell(cbl) = (p->Cell(cbl.Right()) + p->Cell(cbl.Top()))/2.0;
-  
-  Iterator cbr = boit.CornerBottomRight();
-  p->Cell(cbr) = (p->Cell(cbr.Left()) + p->Cell(cbr.Top()))/2.0;
-  
-  Iterator ctl = boit.CornerTopLeft();
-  p->Cell(ctl) = (p->Cell(ctl.Right()) + p->Cell(ctl.Down()))/2.0;
-  
-  Iterator ctr = boit.CornerTopRight();
-  p->Cell(ctr) = (p->Cell(ctr.Left()) + p->Cell(ctr.Down()))/2.0; 
+  _boundary_p.Apply(p);
 
-  ObstacleIterator oit = ObstacleIterator(this);
+  // Get the ghost cells of the other sides from the neighbouring blocks
+  _comm->CopyBoundary(p);
 
-  for(; oit.Valid(); oit.Next()) {
-    switch (_baked_neighbors[oit]) {
-      case 13:
-        p->Cell(oit) = p->Cell(oit.Top());
-        break;
-
-      case 11:
-        p->Cell(oit) = p->Cell(oit.Right());
-        break;
+  _obstacle_p.Apply(p);
 
-      case 7:
-        p->Cell(oit) = p->Cell(oit.Down());
-        break;
-
-      case 14:
-        p->Cell(oit) = p->Cell(oit.Left());
-        break;
-
-      case 3:
-        p->Cell(oit) = 0.5 * (p->Cell(oit.Right()) + p->Cell(oit.Down()));
-        break;
-
-      case 9:
-        p->Cell(oit) = 0.5 * (p->Cell(oit.Right()) + p->Cell(oit.Top()));
-        break;
-
-      case 12:
-        p->Cell(oit) = 0.5 * (p->Cell(oit.Left()) + p->Cell(oit.Top()));
-        break;
-
-      case 6:
-        p->Cell(oit) = 0.5 * (p->Cell(oit.Left()) + p->Cell(oit.Down()));
-        break;
-    }
-  }
+  // Pass the values of obstacles on to the neighbouring blocks
+  if (_obstacles) _comm->CopyBoundary(p);
 }
 
-void Geometry::CycleBoundary_P(Grid *p, BoundaryIterator boit) const{
+void Geometry::CycleBoundary_P(BoundaryPlan *plan, BoundaryIterator boit) const{
   for (; boit.Valid(); boit.Next())
     switch(this->CellTypeAt(boit)){
       case CellType::Obstacle:
-        this->SetPNeumann(p, boit, 0.0);
+        this->SetPNeumann(plan, boit, 0.0);
         break;
         
       case CellType::Inflow:
-        this->SetPNeumann(p, boit, 0.0);
+        this->SetPNeumann(plan, boit, 0.0);
         break;
         
       case CellType::H_Inflow:
@@ -487,19 +573,19 @@ void Geometry::CycleBoundary_P(Grid *p, BoundaryIterator boit) const{
         break;
         
       case CellType::V_Inflow:
-        this->SetPNeumann(p, boit, 0.0);
+        this->SetPNeumann(plan, boit, 0.0);
         break;
         
       case CellType::Outflow:
-        this->SetPDirichlet(p, boit, 0.0);
+        this->SetPDirichlet(plan, boit, 0.0);
         break;
         
       case CellType::V_Slip:
-        this->SetPDirichlet(p, boit, _pressure);
+        this->SetPDirichlet(plan, boit, _pressure);
         break;
         
       case CellType::H_Slip:
-        this->SetPDirichlet(p, boit, _pressure);
+        this->SetPDirichlet(plan, boit, _pressure);
         break;
         
       default:
@@ -508,27 +594,27 @@ void Geometry::CycleBoundary_P(Grid *p, BoundaryIterator boit) const{
     }
 }
 
-void Geometry::SetUDirichlet(Grid *u, const BoundaryIterator &boit, const real_t &value) const{
+void Geometry::SetUDirichlet(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const{
   switch(boit.Boundary()){
     // Set lower boundary
     case 1:
-      u->Cell(boit) = 2 * value - u->Cell(boit.Top());
+      plan->Linear(boit, boit.Top(), -1.0, 2 * value);
       break;
       
     // Set right boundary
     case 2:
-      u->Cell(boit)        = value;
-      u->Cell(boit.Left()) = value;
+      plan->Constant(boit, value);
+      plan->Constant(boit.Left(), value);
       break;
       
     // Set upper boundary
     case 3:
-      u->Cell(boit) = 2 * value - u->Cell(boit.Down());
+      plan->Linear(boit, boit.Down(), -1.0, 2 * value);
       break;
       
     // Set left boundary
     case 4:
-      u->Cell(boit) = value;
+      plan->Constant(boit, value);
       break;
       
     default:
@@ -537,27 +623,27 @@ void Geometry::SetUDirichlet(Grid *u, const BoundaryIterator &boit, const real_t
   }
 }
 
-void Geometry::SetUNeumann(Grid *u, const BoundaryIterator &boit, const real_t &value) const{
+void Geometry::SetUNeumann(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const{
   switch(boit.Boundary()){
     // Set lower boundary
     case 1:
-      u->Cell(boit) = u->Cell(boit.Top()) - _h[1] * value;
+      plan->Linear(boit, boit.Top(), 1.0, -_h[1] * value);
       break;
       
     // Set right boundary
     case 2:
-      u->Cell(boit.Left()) = u->Cell(boit.Left().Left()) + _h[0] * value;
-      u->Cell(boit)        = u->Cell(boit.Left());
+      plan->Linear(boit.Left(), boit.Left().Left(), 1.0, _h[0] * value);
+      plan->Linear(boit, boit.Left(), 1.0, 0.0);
       break;
       
     // Set upper boundary
     case 3:
-      u->Cell(boit) = u->Cell(boit.Down()) + _h[1] * value;
+      plan->Linear(boit, boit.Down(), 1.0, _h[1] * value);
       break;
       
     // Set left boundary
     case 4:
-      u->Cell(boit) = u->Cell(boit.Right()) - _h[0] * value;
+      plan->Linear(boit, boit.Right(), 1.0, -_h[0] * value);
       break;
       
     default:
@@ -566,44 +652,44 @@ void Geometry::SetUNeumann(Grid *u, const BoundaryIterator &boit, const real_t &
   }
 }
   
-void Geometry::SetUParabol(Grid *u, const BoundaryIterator &boit, const real_t &value, real_t &coord) const{
+void Geometry::SetUParabol(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value, real_t &coord) const{
   
   // Calculate lower boundary value for parabol, if necessary
   if (this->CellTypeAt(boit.Down())!=CellType::V_Inflow){
-    u->Cell(boit.Down()) = 4 * value / _length[1] * (coord - coord * coord / _length[1]);
+    plan->Constant(boit.Down(), 4 * value / _length[1] * (coord - coord * coord / _length[1]));
   }
 
   coord += _h[1];
-  u->Cell(boit) = 4 * value / _length[1] * (coord - coord * coord / _length[1]);
+  plan->Constant(boit, 4 * value / _length[1] * (coord - coord * coord / _length[1]));
   
   // Calculate upper boundary value for parabol, if necessary
   if (this->CellTypeAt(boit.Top())!=CellType::V_Inflow){
     coord +=_h[1];
-    u->Cell(boit.Top()) = 4 * value / _length[1] * (coord - coord * coord / _length[1]);
+    plan->Constant(boit.Top(), 4 * value / _length[1] * (coord - coord * coord / _length[1]));
   }
 }
 
-void Geometry::SetVDirichlet(Grid *v, const BoundaryIterator &boit, const real_t &value) const{
+void Geometry::SetVDirichlet(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const{
   switch(boit.Boundary()){
     // Set lower boundary
     case 1:
-      v->Cell(boit) = value;
+      plan->Constant(boit, value);
       break;
       
     // Set right boundary
     case 2:
-      v->Cell(boit) = 2 * value - v->Cell(boit.Left());
+      plan->Linear(boit, boit.Left(), -1.0, 2 * value);
       break;
       
     // Set upper boundary
     case 3:
-      v->Cell(boit) = value;
-      v->Cell(boit.Down()) = value;
+      plan->Constant(boit, value);
+      plan->Constant(boit.Down(), value);
       break;
       
     // Set left boundary
     case 4:
-      v->Cell(boit) = 2 * value - v->Cell(boit.Right());
+      plan->Linear(boit, boit.Right(), -1.0, 2 * value);
       break;
       
     default:
@@ -612,27 +698,27 @@ void Geometry::SetVDirichlet(Grid *v, const BoundaryIterator &boit, const real_t
   }
 }
 
-void Geometry::SetVNeumann(Grid *v, const BoundaryIterator &boit, const real_t &value) const{
+void Geometry::SetVNeumann(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const{
   switch(boit.Boundary()){
     // Set lower boundary
     case 1:
-      v->Cell(boit) = v->Cell(boit.Top()) - _h[1] * value;
+      plan->Linear(boit, boit.Top(), 1.0, -_h[1] * value);
       break;
       
     // Set right boundary
     case 2:
-      v->Cell(boit) = v->Cell(boit.Left()) + _h[0] * value;
+      plan->Linear(boit, boit.Left(), 1.0, _h[0] * value);
       break;
       
     // Set upper boundary
     case 3:
-      v->Cell(boit.Down()) = v->Cell(boit.Down().Down()) + _h[1] * value;
-      v->Cell(boit)        = v->Cell(boit.Down());
+      plan->Linear(boit.Down(), boit.Down().Down(), 1.0, _h[1] * value);
+      plan->Linear(boit, boit.Down(), 1.0, 0.0);
       break;
       
     // Set left boundary
     case 4:
-      v->Cell(boit) = v->Cell(boit.Right()) - _h[0] * value;
+      plan->Linear(boit, boit.Right(), 1.0, -_h[0] * value);
       break;
       
     default:
@@ -641,26 +727,26 @@ void Geometry::SetVNeumann(Grid *v, const BoundaryIterator &boit, const real_t &
   }
 }
 
-void Geometry::SetPDirichlet(Grid *p, const BoundaryIterator &boit, const real_t &value) const{
+void Geometry::SetPDirichlet(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const{
   switch(boit.Boundary()){
     // Set lower boundary
     case 1:
-      p->Cell(boit) = 2 * value - p->Cell(boit.Top());
+      plan->Linear(boit, boit.Top(), -1.0, 2 * value);
       break;
       
     // Set right boundary
     case 2:
-      p->Cell(boit) = 2 * value - p->Cell(boit.Left());
+      plan->Linear(boit, boit.Left(), -1.0, 2 * value);
       break;
       
     // Set upper boundary
     case 3:
-      p->Cell(boit) = 2 * value - p->Cell(boit.Down());
+      plan->Linear(boit, boit.Down(), -1.0, 2 * value);
       break;
       
     // Set left boundary
     case 4:
-      p->Cell(boit) = 2 * value - p->Cell(boit.Right());
+      plan->Linear(boit, boit.Right(), -1.0, 2 * value);
       break;
       
     default:
@@ -669,26 +755,26 @@ void Geometry::SetPDirichlet(Grid *p, const BoundaryIterator &boit, const real_t
   }
 }
 
-void Geometry::SetPNeumann(Grid *p, const BoundaryIterator &boit, const real_t &value) const{
+void Geometry::SetPNeumann(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const{
   switch(boit.Boundary()){
     // Set lower boundary
     case 1:
-      p->Cell(boit) = p->Cell(boit.Top()) - _h[1] * value;
+      plan->Linear(boit, boit.Top(), 1.0, -_h[1] * value);
       break;
       
     // Set right boundary
     case 2:
-      p->Cell(boit) = p->Cell(boit.Left()) + _h[0] * value;
+      plan->Linear(boit, boit.Left(), 1.0, _h[0] * value);
       break;
       
     // Set upper boundary
     case 3:
-      p->Cell(boit) = p->Cell(boit.Down()) + _h[1] * value;
+      plan->Linear(boit, boit.Down(), 1.0, _h[1] * value);
       break;
       
     // Set left boundary
     case 4:
-      p->Cell(boit) = p->Cell(boit.Right()) - _h[0] * value;
+      plan->Linear(boit, boit.Right(), 1.0, -_h[0] * value);
       break;
       
     default:
@@ -705,6 +791,71 @@ char Geometry::CellTypeAt(index_t xpos, index_t ypos) const {
   return _cells[ypos * _size[0] + xpos];
 }
 
+bool Geometry::IsPDirichlet(index_t pos) const {
+  switch (_cells[pos]) {
+    case CellType::Outflow:
+    case CellType::V_Slip:
+    case CellType::H_Slip:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+bool Geometry::ObstacleFree() const {
+  InteriorIterator init(this);
+
+  for (init.First(); init.Valid(); init.Next())
+    if (_cells[init] != CellType::Fluid)
+      return false;
+
+  return true;
+}
+
+int Geometry::PBoundaryType(const index_t &boundary) const {
+  // First cell, step and number of cells of the boundary without corners
+  index_t first, step, n;
+
+  switch (boundary) {
+    case 1:
+      first = 1;
+      step  = 1;
+      n     = _size[0] - 2;
+      break;
+
+    case 2:
+      first = 2 * _size[0] - 1;
+      step  = _size[0];
+      n     = _size[1] - 2;
+      break;
+
+    case 3:
+      first = (_size[1] - 1) * _size[0] + 1;
+      step  = 1;
+      n     = _size[0] - 2;
+      break;
+
+    case 4:
+      first = _size[0];
+      step  = _size[0];
+      n     = _size[1] - 2;
+      break;
+
+    default:
+      throw std::runtime_error(std::string("Failed to operate with given boundary value: "+ std::to_string(boundary)));
+      break;
+  }
+
+  const bool dirichlet = this->IsPDirichlet(first);
+
+  for (index_t c = 1; c < n; ++c)
+    if (this->IsPDirichlet(first + c * step) != dirichlet)
+      return -1;
+
+  return dirichlet ? 1 : 0;
+}
+
 int Geometry::BakedNeighbors(index_t pos) const {
   return _baked_neighbors[pos];
 }
@@ -713,7 +864,15 @@ const char* Geometry::GetCells() const {
   return _cells;
 }
 
-void Geometry::FillCellType(Grid* g) {
+const index_t *Geometry::FluidSegments() const {
+  return _segments;
+}
+
+const index_t &Geometry::NFluidSegments() const {
+  return _n_segments;
+}
+
+void Geometry::FillCellType(Grid* g) const {
   Iterator it(this);
   for (; it.Valid(); it.Next()) {
     g->Cell(it) = _cells[it] == CellType::Fluid ? 1.0 : 0.0;
@@ -732,4 +891,52 @@ int* Geometry::NeighbourCode(index_t pos) const {
   _nb[3] = pos % _size[0] == 0 ? 1 : _cells[_nb[3]] != CellType::Fluid;
 
   return _nb;
-}
\ No newline at end of file
+}
+
+void BoundaryPlan::Clear() {
+  _target.clear();
+  _src0.clear();
+  _src1.clear();
+  _coef0.clear();
+  _coef1.clear();
+  _value.clear();
+}
+
+void BoundaryPlan::Constant(const index_t &target, const real_t &value) {
+  // Reading the target itself with a zero factor keeps Apply free of branches
+  this->Linear(target, target, 0.0, value);
+}
+
+void BoundaryPlan::Linear(const index_t &target, const index_t &src, const real_t &coef, const real_t &value) {
+  _target.push_back(target);
+  _src0.push_back(src);
+  _src1.push_back(src);
+  _coef0.push_back(coef);
+  _coef1.push_back(0.0);
+  _value.push_back(value);
+}
+
+void BoundaryPlan::Average(const index_t &target, const index_t &src0, const index_t &src1, const real_t &coef) {
+  _target.push_back(target);
+  _src0.push_back(src0);
+  _src1.push_back(src1);
+  _coef0.push_back(coef);
+  _coef1.push_back(coef);
+  _value.push_back(0.0);
+}
+
+void BoundaryPlan::Apply(Grid *grid) const {
+  real_t *data = grid->Data();
+  const index_t n = _target.size();
+
+  const index_t *target = _target.data();
+  const index_t *src0   = _src0.data();
+  const index_t *src1   = _src1.data();
+  const real_t  *coef0  = _coef0.data();
+  const real_t  *coef1  = _coef1.data();
+  const real_t  *value  = _value.data();
+
+  // Not vectorized, since an operation may read the target of an earlier one
+  for (index_t o = 0; o < n; ++o)
+    data[target[o]] = coef0[o] * data[src0[o]] + coef1[o] * data[src1[o]] + value[o];
+}
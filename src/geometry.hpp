@@ -17,10 +17,75 @@
 
 #include "typedef.hpp"
 #include "iterator.hpp"
+
+#include <vector>
 //------------------------------------------------------------------------------
 #ifndef __GEOMETRY_HPP
 #define __GEOMETRY_HPP
 //------------------------------------------------------------------------------
+
+/// A list of boundary value updates of one field, compiled once from the cell
+/// types. Each operation sets a target cell to a linear combination of two
+/// source cells plus a constant:
+///
+///   g[target] = coef0 * g[src0] + coef1 * g[src1] + value
+///
+/// Applying the plan is a single loop over the operations without looking at
+/// the cell types. The operations are applied in the order they were added,
+/// so an operation may read a cell written by an earlier one.
+class BoundaryPlan {
+public:
+  /// Removes all operations.
+  void Clear();
+
+  /// Appends an operation setting the target cell to a constant value.
+  ///
+  /// @param target index_t The cell to set
+  /// @param value real_t The value
+  void Constant(const index_t &target, const real_t &value);
+
+  /// Appends an operation setting the target cell to coef * g[src] + value.
+  ///
+  /// @param target index_t The cell to set
+  /// @param src index_t The source cell
+  /// @param coef real_t The factor of the source cell
+  /// @param value real_t The constant to add
+  void Linear(const index_t &target, const index_t &src, const real_t &coef, const real_t &value);
+
+  /// Appends an operation setting the target cell to coef * (g[src0] + g[src1]).
+  ///
+  /// @param target index_t The cell to set
+  /// @param src0 index_t The first source cell
+  /// @param src1 index_t The second source cell
+  /// @param coef real_t The factor of both source cells
+  void Average(const index_t &target, const index_t &src0, const index_t &src1, const real_t &coef);
+
+  /// Applies all operations to the given grid.
+  ///
+  /// @param grid Grid The field to update
+  void Apply(Grid *grid) const;
+
+private:
+  /// _target vector<index_t> The cell set by each operation
+  std::vector<index_t> _target;
+
+  /// _src0 vector<index_t> The first source cell of each operation
+  std::vector<index_t> _src0;
+
+  /// _src1 vector<index_t> The second source cell of each operation
+  std::vector<index_t> _src1;
+
+  /// _coef0 vector<real_t> The factor of the first source cell
+  std::vector<real_t> _coef0;
+
+  /// _coef1 vector<real_t> The factor of the second source cell
+  std::vector<real_t> _coef1;
+
+  /// _value vector<real_t> The constant of each operation
+  std::vector<real_t> _value;
+};
+//------------------------------------------------------------------------------
+
 class Geometry {
 public:
   /// Constructs a geometry instance with default values. Other values can be
@@ -51,6 +116,14 @@ public:
   ///  @param file char* File path as char array
   void Load(const char *file);
 
+  /// Restricts the geometry to the block of the calling process. Afterwards
+  /// Size() returns the size of the block including its ghost cells, while
+  /// Length() and Mesh() still describe the whole domain. Must be called
+  /// after Load.
+  ///
+  /// @param comm Communicator The communicator of the parallel run
+  void Decompose(Communicator *comm);
+
   /// Recalculates the mesh width, inverse mesh width and overhang-size and
   /// saves it in their correspondig private members.
   void Recalculate();
@@ -60,6 +133,24 @@ public:
   /// @return multi_index_t The size in x and y dimension
   const multi_index_t &Size() const;
 
+  /// Returns the number of cells of the whole domain in each dimension. This
+  /// equals Size() unless the geometry is decomposed.
+  ///
+  /// @return multi_index_t The size in x and y dimension
+  const multi_index_t &TotalSize() const;
+
+  /// Returns the global index of the lower left cell of the own block. Adding
+  /// it to a local index gives the global index.
+  ///
+  /// @return multi_index_t The offset in x and y dimension
+  const multi_index_t &Offset() const;
+
+  /// Returns the communicator used to exchange values with the neighbouring
+  /// blocks.
+  ///
+  /// @return Communicator The communicator
+  const Communicator *Comm() const;
+
   /// Returns the length of the domain in each dimension.
   ///
   /// @return multi_real_t The domain length in x and y dimension
@@ -118,6 +209,29 @@ public:
   /// @return char The cell type at the given position
   char CellTypeAt(index_t xpos, index_t ypos) const;
   
+  /// Returns whether the pressure boundary condition at the given boundary
+  /// cell is of Dirichlet type. Obstacle and inflow cells impose a Neumann
+  /// condition on the pressure, outflow and slip cells a Dirichlet condition.
+  ///
+  /// @see Geometry::CycleBoundary_P
+  /// @param pos index_t The position of the boundary cell
+  /// @return bool True if the pressure is fixed at the given cell
+  bool IsPDirichlet(index_t pos) const;
+
+  /// Returns whether all interior cells are fluid cells.
+  ///
+  /// @return bool True if there are no obstacles inside the domain
+  bool ObstacleFree() const;
+
+  /// Returns the type of the pressure boundary condition shared by all cells
+  /// of the given boundary, not counting the corners.
+  ///
+  /// @see BoundaryIterator::BoundaryIterator() for how the boundaries are
+  ///   numbered
+  /// @param boundary index_t The boundary
+  /// @return int 1 for Dirichlet, 0 for Neumann and -1 if the types are mixed
+  int PBoundaryType(const index_t &boundary) const;
+
   /// Retrun value of _baked_neighbors array at position pos.
   ///
   /// @param pos index_t Position to get array at.
@@ -138,16 +252,44 @@ public:
   ///   inflow boundary etc.
   const char* GetCells() const;
 
+  /// Returns the fluid cells of the interior as segments of consecutive fluid
+  /// cells within a row, in the order of the cells. Segment s covers the
+  /// cells from FluidSegments()[2 * s] up to, but not including,
+  /// FluidSegments()[2 * s + 1]. Loops over the segments skip obstacles
+  /// without looking at the cell types, so their work scales with the number
+  /// of fluid cells.
+  ///
+  /// @return index_t* The first and the end index of each segment
+  const index_t *FluidSegments() const;
+
+  /// Returns the number of segments of fluid cells.
+  ///
+  /// @see FluidSegments
+  /// @return index_t The number of segments
+  const index_t &NFluidSegments() const;
+
   /// Fills a grid with the cell types of the cells encoded as float values.
   /// Fluid cells get a value of 1.0, everything else 0.0.
   ///
   /// @param Grid* The grid that will be filled
-  void FillCellType(Grid* g);
+  void FillCellType(Grid* g) const;
 
 private:
   /// _size multi_index_t The number of cells in each dimension
   multi_index_t _size;
 
+  /// _total_size multi_index_t The number of cells of the whole domain
+  multi_index_t _total_size;
+
+  /// _offset multi_index_t The global index of the lower left cell
+  multi_index_t _offset;
+
+  /// _comm Communicator The communicator of the parallel run
+  const Communicator *_comm;
+
+  /// _obstacles bool True if there are obstacles anywhere inside the domain
+  bool _obstacles;
+
   /// _length multi_real_t The domain length in each dimension
   multi_real_t _length;
 
@@ -181,80 +323,119 @@ private:
   /// This field is calculated at the beginning in order to avoid having to re-
   /// calculate the codes on every timestep.
   int* _baked_neighbors;
+
+  /// _segments index_t* The first and end index of each segment of fluid
+  ///   cells of the own block
+  index_t *_segments;
+
+  /// _n_segments index_t The number of segments of fluid cells
+  index_t _n_segments;
+
+  /// _boundary_u BoundaryPlan The updates of u on the domain boundary of the
+  ///   own block, applied before the exchange with the neighbouring blocks
+  BoundaryPlan _boundary_u;
+
+  /// _boundary_v BoundaryPlan The updates of v on the domain boundary
+  BoundaryPlan _boundary_v;
+
+  /// _boundary_p BoundaryPlan The updates of p on the domain boundary
+  BoundaryPlan _boundary_p;
+
+  /// _obstacle_u BoundaryPlan The updates of u next to obstacles, applied
+  ///   after the exchange with the neighbouring blocks
+  BoundaryPlan _obstacle_u;
+
+  /// _obstacle_v BoundaryPlan The updates of v next to obstacles
+  BoundaryPlan _obstacle_v;
+
+  /// _obstacle_p BoundaryPlan The updates of p next to obstacles
+  BoundaryPlan _obstacle_p;
   
-  /// Cycle the full boundary given by BoundaryIterator boit on Grid u
+  /// Cycle the full boundary given by BoundaryIterator boit and append the
+  /// updates of u to the plan
   ///
-  /// @param u Grid The velocity field u in x direction
+  /// @param plan BoundaryPlan The plan of the velocity field u in x direction
   /// @param boit BoundaryIterator Boundary to iterate until boit.Valid() equals false
-  void CycleBoundary_U(Grid *u, BoundaryIterator boit) const;
+  void CycleBoundary_U(BoundaryPlan *plan, BoundaryIterator boit) const;
   
-  /// Cycle the full boundary given by BoundaryIterator boit on Grid v
+  /// Cycle the full boundary given by BoundaryIterator boit and append the
+  /// updates of v to the plan
   ///
-  /// @param v Grid The velocity field v in y direction
+  /// @param plan BoundaryPlan The plan of the velocity field v in y direction
   /// @param boit BoundaryIterator Boundary to iterate until boit.Valid() equals false
-  void CycleBoundary_V(Grid *v, BoundaryIterator boit) const;
+  void CycleBoundary_V(BoundaryPlan *plan, BoundaryIterator boit) const;
   
-  /// Cycle the full boundary given by BoundaryIterator boit on Grid p
+  /// Cycle the full boundary given by BoundaryIterator boit and append the
+  /// updates of p to the plan
   ///
-  /// @param p Grid The pressure field p
+  /// @param plan BoundaryPlan The plan of the pressure field p
   /// @param boit BoundaryIterator Boundary to iterate until boit.Valid() equals false
-  void CycleBoundary_P(Grid *p, BoundaryIterator boit) const;
+  void CycleBoundary_P(BoundaryPlan *plan, BoundaryIterator boit) const;
   
-  /// Sets Dirichlet boundary condition for Grid u on boundary boit.Boundary() at position boit to value
+  /// Sets Dirichlet boundary condition in the plan on boundary boit.Boundary() at position boit to value
   /// 
-  /// @param u Grid The velocity field u in x direction
+  /// @param plan BoundaryPlan The plan of the velocity field u in x direction
   /// @param boit BoundaryIterator Position to set boundary condition
   /// @param value real_t Value to set as boundary condition
-  void SetUDirichlet(Grid *u, const BoundaryIterator &boit, const real_t &value) const;
+  void SetUDirichlet(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const;
   
-  /// Sets Neumann boundary condition for Grid u on boundary boit.Boundary() at position boit to value
+  /// Sets Neumann boundary condition in the plan on boundary boit.Boundary() at position boit to value
   /// 
-  /// @param u Grid The velocity field u in x direction
+  /// @param plan BoundaryPlan The plan of the velocity field u in x direction
   /// @param boit BoundaryIterator Position to set boundary condition
   /// @param value real_t Value to set as boundary condition
-  void SetUNeumann(Grid *u, const BoundaryIterator &boit, const real_t &value) const;
+  void SetUNeumann(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const;
   
-  /// Sets Dirichlet boundary condition for Grid u on boundary boit.Boundary() at position boit to a
+  /// Sets Dirichlet boundary condition in the plan on boundary boit.Boundary() at position boit to a
   /// value corresponding to a parabolic inflow with value being maximal velocity.
-  /// @param u Grid The velocity field u in x direction
+  /// @param plan BoundaryPlan The plan of the velocity field u in x direction
   /// @param boit BoundaryIterator Position to set boundary condition
   /// @param value real_t Value to set as boundary condition
   /// @coord y coordinate of boit to adapt local velocity to the parabol 
-  void SetUParabol(Grid *u, const BoundaryIterator &boit, const real_t &value, real_t &coord) const;
+  void SetUParabol(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value, real_t &coord) const;
   
-/// Sets Dirichlet boundary condition for Grid u on boundary boit.Boundary() at position boit to value
+/// Sets Dirichlet boundary condition in the plan on boundary boit.Boundary() at position boit to value
   /// 
-  /// @param v Grid The velocity field v in y direction
+  /// @param plan BoundaryPlan The plan of the velocity field v in y direction
   /// @param boit BoundaryIterator Position to set boundary condition
   /// @param value real_t Value to set as boundary condition
-  void SetVDirichlet(Grid *v, const BoundaryIterator &boit, const real_t &value) const;
+  void SetVDirichlet(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const;
   
-  /// Sets Neumann boundary condition for Grid u on boundary boit.Boundary() at position boit to value
+  /// Sets Neumann boundary condition in the plan on boundary boit.Boundary() at position boit to value
   /// 
-  /// @param v Grid The velocity field v in y direction
+  /// @param plan BoundaryPlan The plan of the velocity field v in y direction
   /// @param boit BoundaryIterator Position to set boundary condition
   /// @param value real_t Value to set as boundary condition
-  void SetVNeumann(Grid *v, const BoundaryIterator &boit, const real_t &value) const;
+  void SetVNeumann(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const;
   
-  /// Sets Dirichlet boundary condition for Grid u on boundary boit.Boundary() at position boit to value
+  /// Sets Dirichlet boundary condition in the plan on boundary boit.Boundary() at position boit to value
   /// 
-  /// @param p Grid The pressure field p
+  /// @param plan BoundaryPlan The plan of the pressure field p
   /// @param boit BoundaryIterator Position to set boundary condition
   /// @param value real_t Value to set as boundary condition
-  void SetPDirichlet(Grid *p, const BoundaryIterator &boit, const real_t &value) const;
+  void SetPDirichlet(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const;
   
-  /// Sets Neumann boundary condition for Grid u on boundary boit.Boundary() at position boit to value
+  /// Sets Neumann boundary condition in the plan on boundary boit.Boundary() at position boit to value
   /// 
-  /// @param p Grid The pressure field p
+  /// @param plan BoundaryPlan The plan of the pressure field p
   /// @param boit BoundaryIterator Position to set boundary condition
   /// @param value real_t Value to set as boundary condition
-  void SetPNeumann(Grid *p, const BoundaryIterator &boit, const real_t &value) const;
+  void SetPNeumann(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const;
 
   /// Bakes the neighbor codes used in calculation boundary values for free geometries.
   /// Baking here means to calculate the values for each cell once and saving the
   /// value instead of recalculating it every time. This assumes the neighborhood
   /// of the cell doesn't change its cell types.
   void BakeNeighbors();
+
+  /// Collects the segments of consecutive fluid cells of the interior of the
+  /// own block.
+  void BakeSegments();
+
+  /// Compiles the boundary plans of u, v and p for the own block from the
+  /// cell types. Must be called again whenever the cell types, the block or
+  /// the boundary values change.
+  void BakePlans();
 };
 //------------------------------------------------------------------------------
 #endif // __GEOMETRY_HPP
@@ -4,9 +4,27 @@
 #include "iterator.hpp"
 
 #include <cmath>     // std::fabs
+#include <cstdlib>   // posix_memalign, free
+#include <cstring>   // memcpy
 
 using namespace std;
 
+/// Alignment of the grid data in bytes. One cache line, which is also the
+/// width of the widest vector registers (AVX-512).
+#define GRID_ALIGNMENT 64
+
+/// Allocates n values aligned to GRID_ALIGNMENT, so the vectorized loops over
+/// the data start on a vector boundary. Must be released with free.
+///
+/// @param n index_t The number of values
+/// @return real_t* The uninitialized values
+static real_t *AllocAligned(const index_t &n) {
+  void *ptr = NULL;
+  if (posix_memalign(&ptr, GRID_ALIGNMENT, n * sizeof(real_t)) != 0)
+    throw runtime_error("Failed to allocate the grid data!");
+  return static_cast<real_t *>(ptr);
+}
+
 /// Returns the value for the hat function at the given position on the unit
 ///  square. This function provides weights for each corner value that,
 ///  multiplied in sum by the values, interpolate the value based on the four
@@ -40,11 +58,12 @@ Grid::Grid(const Geometry *geom)
   
   // Calculate grid size and create data
   const multi_index_t size = _geom->Size();
-  _data = new real_t[(size[0])*(size[1])];
+  _data = AllocAligned((size[0])*(size[1]));
   
-  // Save shorthand variables for inverted mesh width
+  // Save shorthand variables for inverted mesh width and row length
   _sh_im0 = 1.0 / _geom->Mesh()[0];
   _sh_im1 = 1.0 / _geom->Mesh()[1];
+  _stride = size[0];
 
   // Init data with zeros
   this->Initialize(real_t(0.0));
@@ -55,18 +74,19 @@ Grid::Grid(const Geometry *geom, const multi_real_t &offset)
   
   // Calculate grid size and create data
   const multi_index_t size = _geom->Size();
-  _data = new real_t[(size[0])*(size[1])];
+  _data = AllocAligned((size[0])*(size[1]));
   
-  // Save shorthand variables for inverted mesh width
+  // Save shorthand variables for inverted mesh width and row length
   _sh_im0 = 1.0 / _geom->Mesh()[0];
   _sh_im1 = 1.0 / _geom->Mesh()[1];
+  _stride = size[0];
   
   // Init data with zeros
   this->Initialize(real_t(0.0));
 }
 
 Grid::~Grid(){
-  delete[] _data;
+  free(_data);
 }
 
 void Grid::Initialize(const real_t &value) {
@@ -78,39 +98,149 @@ void Grid::Initialize(const real_t &value) {
   }
 }
 
-real_t &Grid::Cell(const index_t &it) {
-  return _data[it];
+void Grid::CopyFrom(const Grid *grid) {
+  const multi_index_t size = _geom->Size();
+  _offset = grid->_offset;
+  memcpy(_data, grid->_data, size[0] * size[1] * sizeof(real_t));
+}
+
+void Grid::Write(FILE *handle) const {
+  const multi_index_t size = _geom->Size();
+  const size_t n = size[0] * size[1];
+  if (fwrite(_data, sizeof(real_t), n, handle) != n)
+    throw runtime_error("Failed to write the grid data!");
 }
 
-const real_t &Grid::Cell(const index_t &it) const {
-  return _data[it];
+void Grid::Read(FILE *handle) {
+  const multi_index_t size = _geom->Size();
+  const size_t n = size[0] * size[1];
+  if (fread(_data, sizeof(real_t), n, handle) != n)
+    throw runtime_error("Failed to read the grid data!");
 }
 
 real_t Grid::Interpolate(const multi_real_t &pos) const {
+  real_t value;
+  this->Interpolate(1, &pos[0], &pos[1], &value);
+  return value;
+}
+
+SIMD_CLONES void Grid::Interpolate(const index_t &n, const real_t *x,
+                                   const real_t *y, real_t *values) const {
+  // The same steps as in InterpolationWeights, with the hat functions written
+  // out and the corrections of the last column and row done by selection, so
+  // the loop has no branches
+  const multi_index_t &block = _geom->Offset();
+  const multi_index_t &size  = _geom->Size();
+  const real_t len_x  = _geom->Length()[0];
+  const real_t len_y  = _geom->Length()[1];
+  const real_t h_x    = _geom->Mesh()[0];
+  const real_t h_y    = _geom->Mesh()[1];
+  const real_t off_x  = _offset[0];
+  const real_t off_y  = _offset[1];
+  const real_t blk_x  = block[0] * h_x;
+  const real_t blk_y  = block[1] * h_y;
+  const index_t size_x = size[0];
+  const index_t size_y = size[1];
+  const real_t last_x = size_x - 1;
+  const real_t last_y = size_y - 1;
+  const real_t *data  = _data;
+  const index_t stride = _stride;
+
+  SIMD_LOOP
+  for (index_t i = 0; i < n; ++i) {
+    // Position relative to the lower left cell of the own block. The
+    // selections equal min and max, which the compiler does not vectorize.
+    real_t px = x[i];
+    real_t py = y[i];
+    px = real_t(0.0) < px ? px : real_t(0.0);
+    py = real_t(0.0) < py ? py : real_t(0.0);
+    px = (px < len_x ? px : len_x) - off_x - blk_x;
+    py = (py < len_y ? py : len_y) - off_y - blk_y;
+
+    // Lower left grid point and position within the unit square
+    real_t fx = floor(px / h_x) + 1;
+    real_t fy = floor(py / h_y) + 1;
+    fx = real_t(0.0) < fx ? fx : real_t(0.0);
+    fy = real_t(0.0) < fy ? fy : real_t(0.0);
+    const index_t cx = (int)(fx < last_x ? fx : last_x);
+    const index_t cy = (int)(fy < last_y ? fy : last_y);
+    const real_t  mx = px / h_x - cx + 1;
+    const real_t  my = py / h_y - cy + 1;
+
+    real_t w0 = mx * my - my - mx + 1;
+    real_t w1 = -mx * my + mx;
+    real_t w2 = -mx * my + my;
+    real_t w3 = mx * my;
+
+    // Move the weights of neighbours outside of the grid to the cell before.
+    // The sums are computed in any case, since the compiler does not move
+    // floating point operations out of a condition.
+    const bool end_x = cx == size_x - 1;
+    const real_t w1_x = w1 + w0;
+    const real_t w3_x = w3 + w2;
+    w1 = end_x ? w1_x : w1;
+    w3 = end_x ? w3_x : w3;
+    w0 = end_x ? real_t(0.0) : w0;
+    w2 = end_x ? real_t(0.0) : w2;
+
+    const bool end_y = cy == size_y - 1;
+    const real_t w2_y = w2 + w0;
+    const real_t w3_y = w3 + w1;
+    w2 = end_y ? w2_y : w2;
+    w3 = end_y ? w3_y : w3;
+    w0 = end_y ? real_t(0.0) : w0;
+    w1 = end_y ? real_t(0.0) : w1;
+
+    const index_t k = (cy - end_y) * stride + cx - end_x;
+    values[i] = data[k] * w0
+      + data[k + 1] * w1
+      + data[k + stride] * w2
+      + data[k + stride + 1] * w3;
+  }
+}
+
+void Grid::InterpolationWeights(const multi_real_t &pos, index_t &cell,
+                                real_t weight[4]) const {
+  // Position relative to the lower left cell of the own block
+  const multi_index_t &block = _geom->Offset();
   multi_real_t innerpos = {
-    min(_geom->Length()[0], max(0.0, pos[0])) - _offset[0],
-    min(_geom->Length()[1], max(0.0, pos[1])) - _offset[1]
+    min(_geom->Length()[0], max(real_t(0.0), pos[0])) - _offset[0] - block[0] * _geom->Mesh()[0],
+    min(_geom->Length()[1], max(real_t(0.0), pos[1])) - _offset[1] - block[1] * _geom->Mesh()[1]
   };
 
-  // Clamp to a grid point (lower left corner)
+  // Clamp to a grid point (lower left corner). Positions outside of the own
+  // block are clamped to its ghost cells.
+  const multi_index_t &size = _geom->Size();
   multi_index_t clamp = {
-    (index_t)(floor(innerpos[0] / _geom->Mesh()[0]) + 1),
-    (index_t)(floor(innerpos[1] / _geom->Mesh()[1]) + 1)
+    (index_t)(min(real_t(size[0] - 1), max(real_t(0.0), floor(innerpos[0] / _geom->Mesh()[0]) + 1))),
+    (index_t)(min(real_t(size[1] - 1), max(real_t(0.0), floor(innerpos[1] / _geom->Mesh()[1]) + 1)))
   };
   // Calculate position within unit square spanned by the four grid points
   multi_real_t modpos = {
     innerpos[0] / _geom->Mesh()[0] - clamp[0] + 1,
     innerpos[1] / _geom->Mesh()[1] - clamp[1] + 1
   };
-  
-  // Calculate interpolated value by weighing the value of each corner
-  // by the weight given by the hat function for that corner
-  Iterator it = Iterator(_geom, clamp[1] * _geom->Size()[0] + clamp[0]);
-  return this->Cell(it) * hat(1, modpos)
-    + this->Cell(it.Right()) * hat(2, modpos)
-    + this->Cell(it.Top()) * hat(3, modpos)
-    + this->Cell(it.Top().Right()) * hat(4, modpos);
 
+  // The weight of each corner is given by the hat function for that corner
+  for (int corner = 0; corner < 4; ++corner)
+    weight[corner] = hat(corner + 1, modpos);
+
+  // On the last column or row the right or top neighbours would lie outside
+  // of the grid, so the cell itself is used for them by moving the weights
+  // to the neighbour of the cell before
+  if (clamp[0] == size[0] - 1) {
+    clamp[0]--;
+    weight[1] += weight[0];
+    weight[3] += weight[2];
+    weight[0] = weight[2] = 0.0;
+  }
+  if (clamp[1] == size[1] - 1) {
+    clamp[1]--;
+    weight[2] += weight[0];
+    weight[3] += weight[1];
+    weight[0] = weight[1] = 0.0;
+  }
+  cell = clamp[1] * _stride + clamp[0];
 }
 
 real_t Grid::dx_l(const Iterator &it) const{
@@ -177,16 +307,17 @@ real_t Grid::dyy(const Iterator &it) const{
 
 real_t Grid::DC_udu_x(const Iterator &it, const real_t &alpha) const {
   #ifndef USE_OPTIMIZATIONS
-  real_t ft = pow((this->Cell(it) + this->Cell(it.Right())), 2.0)
-    - pow((this->Cell(it.Left()) + this->Cell(it)), 2.0);
+  real_t ft = (this->Cell(it) + this->Cell(it.Right())) * (this->Cell(it) + this->Cell(it.Right()))
+    - (this->Cell(it.Left()) + this->Cell(it)) * (this->Cell(it.Left()) + this->Cell(it));
   real_t st = fabs(this->Cell(it) + this->Cell(it.Right())) * (this->Cell(it) - this->Cell(it.Right()))
     - fabs(this->Cell(it.Left()) + this->Cell(it)) * (this->Cell(it.Left()) - this->Cell(it));
   return (0.25 * (ft + alpha * st)) / _geom->Mesh()[0];
   #endif
 
   #ifdef USE_OPTIMIZATIONS
-  real_t ft = pow((_data[it] + _data[it.Right()]), 2.0)
-    - pow(_data[it.Left()] + _data[it], 2.0);
+  const real_t r = _data[it] + _data[it.Right()];
+  const real_t l = _data[it.Left()] + _data[it];
+  real_t ft = r * r - l * l;
   real_t st = fabs(_data[it] + _data[it.Right()]) * (_data[it] - _data[it.Right()])
     - fabs(_data[it.Left()] + _data[it]) * (_data[it.Left()] - _data[it]);
   return (0.25 * (ft + alpha * st)) * _sh_im0;
@@ -231,16 +362,17 @@ real_t Grid::DC_udv_x(const Iterator &it, const real_t &alpha, const Grid *u) co
 
 real_t Grid::DC_vdv_y(const Iterator &it, const real_t &alpha) const {
   #ifndef USE_OPTIMIZATIONS
-  real_t ft = pow((this->Cell(it) + this->Cell(it.Top())), 2.0)
-    - pow((this->Cell(it.Down()) + this->Cell(it)), 2.0);
+  real_t ft = (this->Cell(it) + this->Cell(it.Top())) * (this->Cell(it) + this->Cell(it.Top()))
+    - (this->Cell(it.Down()) + this->Cell(it)) * (this->Cell(it.Down()) + this->Cell(it));
   real_t st = fabs(this->Cell(it) + this->Cell(it.Top())) * (this->Cell(it) - this->Cell(it.Top()))
     - fabs(this->Cell(it.Down()) + this->Cell(it)) * (this->Cell(it.Down()) - this->Cell(it));
   return (0.25 * (ft + alpha * st)) / _geom->Mesh()[1];
   #endif
 
   #ifdef USE_OPTIMIZATIONS
-  real_t ft = pow(_data[it] + _data[it.Top()], 2.0)
-    - pow(_data[it.Down()] + _data[it], 2.0);
+  const real_t t = _data[it] + _data[it.Top()];
+  const real_t b = _data[it.Down()] + _data[it];
+  real_t ft = t * t - b * b;
   real_t st = fabs(_data[it] + _data[it.Top()]) * (_data[it] - _data[it.Top()])
     - fabs(_data[it.Down()] + _data[it]) * (_data[it.Down()] - _data[it]);
   return (0.25 * (ft + alpha * st)) * _sh_im1;
@@ -302,11 +434,12 @@ real_t Grid::Min() const{
 }
 
 real_t Grid::AbsMax() const{
-  // Create iterator and cycle _data
-  Iterator it(_geom);
+  // Cycle _data, each thread keeps its own maximum
+  const index_t n = _geom->Size()[0] * _geom->Size()[1];
   real_t res = fabs(_data[0]);
-  for (it.First();it.Valid();it.Next())
-    if (fabs(_data[it]) > res) res = fabs(_data[it]);
+  OMP_FOR_REDUCE(max, res)
+  for (index_t k = 0; k < n; ++k)
+    if (fabs(_data[k]) > res) res = fabs(_data[k]);
   return res;
 }
 
@@ -314,6 +447,10 @@ real_t *Grid::Data(){
   return _data;
 }
 
+const real_t *Grid::Data() const{
+  return _data;
+}
+
 void Grid::Print() const{
   // Cycle field with Iterator and print
   Iterator it(_geom);
@@ -16,6 +16,8 @@
  */
 
 #include "typedef.hpp"
+
+#include <cmath> // fabs
 //------------------------------------------------------------------------------
 #ifndef __GRID_HPP
 #define __GRID_HPP
@@ -42,6 +44,22 @@ public:
   /// @param value real_t The value to set in each cell
   void Initialize(const real_t &value);
 
+  /// Copies the values, including the ghost cells, and the offset of another
+  /// grid on the same geometry.
+  ///
+  /// @param grid Grid The grid to copy
+  void CopyFrom(const Grid *grid);
+
+  /// Writes the values, including the ghost cells, in binary form.
+  ///
+  /// @param handle FILE* The file to write to
+  void Write(FILE *handle) const;
+
+  /// Reads the values written by Write.
+  ///
+  /// @param handle FILE* The file to read from
+  void Read(FILE *handle);
+
   /// Write access to the grid cell at position [it].
   ///
   /// @param it Iterator The position
@@ -60,6 +78,32 @@ public:
   ///    coordinates.
   real_t Interpolate(const multi_real_t &pos) const;
 
+  /// Interpolates the values at many positions at once. Gives the same
+  ///  values as Interpolate for each position, but computes the cells and
+  ///  weights of all positions in one vectorized loop.
+  ///
+  ///  @param n index_t The number of positions
+  ///  @param x real_t* The x coordinates of the positions
+  ///  @param y real_t* The y coordinates of the positions
+  ///  @param values real_t* Returns the interpolated value at each position
+  void Interpolate(const index_t &n, const real_t *x, const real_t *y,
+                   real_t *values) const;
+
+  /// Computes the lower left of the four cells and their weights that
+  ///  Interpolate combines at an arbitrary position. The weights only depend
+  ///  on the position relative to the cells, so the same weights apply at
+  ///  all positions shifted by whole mesh widths, as long as these are not
+  ///  clamped to the boundary.
+  ///
+  ///  @param pos multi_real_t An arbitrary position within the grid in absolute
+  ///    coordinates.
+  ///  @param cell index_t Returns the index of the lower left cell; the other
+  ///    cells are its right, top and top right neighbours
+  ///  @param weight real_t[4] Returns the weights of the lower left, lower
+  ///    right, upper left and upper right cell
+  void InterpolationWeights(const multi_real_t &pos, index_t &cell,
+                            real_t weight[4]) const;
+
   /// Computes the left-sided difference quotient in x-dim at [it].
   ///
   /// @param it Iterator The position
@@ -133,6 +177,57 @@ public:
   /// @param u Grid The grid containing the v velocities
   real_t DC_dCv_y(const Iterator &it, const real_t &gamma, const Grid *v) const;
 
+  /// Index based variants of the difference quotients above for the hot loops
+  /// of the time step. The neighbours of cell k are found with constant
+  /// offsets, without constructing iterators or clamping at the boundary, so
+  /// k must be an interior cell. They are defined inline below.
+
+  /// Computes the left-sided difference quotient in x-dim at cell k.
+  ///
+  /// @param k index_t The index of an interior cell
+  real_t dx_l(const index_t &k) const;
+
+  /// Computes the right-sided difference quotient in x-dim at cell k.
+  ///
+  /// @param k index_t The index of an interior cell
+  real_t dx_r(const index_t &k) const;
+
+  /// Computes the left-sided difference quotient in y-dim at cell k.
+  ///
+  /// @param k index_t The index of an interior cell
+  real_t dy_l(const index_t &k) const;
+
+  /// Computes the right-sided difference quotient in y-dim at cell k.
+  ///
+  /// @param k index_t The index of an interior cell
+  real_t dy_r(const index_t &k) const;
+
+  /// Computes the central difference quotient of 2nd order in x-dim at cell k.
+  ///
+  /// @param k index_t The index of an interior cell
+  real_t dxx(const index_t &k) const;
+
+  /// Computes the central difference quotient of 2nd order in y-dim at cell k.
+  ///
+  /// @param k index_t The index of an interior cell
+  real_t dyy(const index_t &k) const;
+
+  /// Computes the derivative of the u field in x direction using the donor
+  /// cell method at cell k.
+  ///
+  /// @param k index_t The index of an interior cell
+  /// @param gamma real_t A weight parameter for the DC algorithm
+  /// @param u Grid The grid containing the u velocities
+  real_t DC_dCu_x(const index_t &k, const real_t &gamma, const Grid *u) const;
+
+  /// Computes the derivative of the v field in y direction using the donor
+  /// cell method at cell k.
+  ///
+  /// @param k index_t The index of an interior cell
+  /// @param gamma real_t A weight parameter for the DC algorithm
+  /// @param v Grid The grid containing the v velocities
+  real_t DC_dCv_y(const index_t &k, const real_t &gamma, const Grid *v) const;
+
   /// Returns the maximal value of the grid.
   ///
   /// @return real_t The maximal value
@@ -152,12 +247,18 @@ public:
   ///
   /// @return real_t* The data of the grid
   real_t *Data();
+
+  /// Returns a pointer to the raw data for read access.
+  ///
+  /// @return real_t* The data of the grid
+  const real_t *Data() const;
   
   /// Prints the grid values to the console.
   void Print() const;
 
 private:
-  /// _data real_t* The raw data of the grid as pointer-array of real_t numbers
+  /// _data real_t* The raw data of the grid as pointer-array of real_t numbers,
+  ///   aligned to a cache line
   real_t *_data;
 
   /// _geom Geometry The geometry instance containing boundary values and such
@@ -172,6 +273,63 @@ private:
 
   /// _sh_im1 real_t Shorthand variable for the inverted mesh width in y direction
   real_t _sh_im1;
+
+  /// _stride index_t The distance of vertically neighbouring cells in _data
+  index_t _stride;
 };
+
+/***************************************************************************
+ *                          INDEX BASED STENCILS                           *
+ ***************************************************************************/
+
+inline real_t &Grid::Cell(const index_t &it) {
+  return _data[it];
+}
+
+inline const real_t &Grid::Cell(const index_t &it) const {
+  return _data[it];
+}
+
+inline real_t Grid::dx_l(const index_t &k) const {
+  return (_data[k] - _data[k - 1]) * _sh_im0;
+}
+
+inline real_t Grid::dx_r(const index_t &k) const {
+  return (_data[k + 1] - _data[k]) * _sh_im0;
+}
+
+inline real_t Grid::dy_l(const index_t &k) const {
+  return (_data[k] - _data[k - _stride]) * _sh_im1;
+}
+
+inline real_t Grid::dy_r(const index_t &k) const {
+  return (_data[k + _stride] - _data[k]) * _sh_im1;
+}
+
+inline real_t Grid::dxx(const index_t &k) const {
+  return (_data[k + 1] + _data[k - 1] - _data[k] - _data[k]) * _sh_im0 * _sh_im0;
+}
+
+inline real_t Grid::dyy(const index_t &k) const {
+  return (_data[k + _stride] + _data[k - _stride] - _data[k] - _data[k]) * _sh_im1 * _sh_im1;
+}
+
+inline real_t Grid::DC_dCu_x(const index_t &k, const real_t &gamma, const Grid *u) const {
+  const real_t *ud = u->_data;
+  real_t ft = ud[k] * 0.5 * (_data[k + 1] + _data[k])
+    - ud[k - 1] * 0.5 * (_data[k] + _data[k - 1]);
+  real_t st = fabs(ud[k]) * 0.5 * (_data[k] - _data[k + 1])
+    - fabs(ud[k - 1]) * 0.5 * (_data[k - 1] - _data[k]);
+  return (ft + gamma * st) * _sh_im0;
+}
+
+inline real_t Grid::DC_dCv_y(const index_t &k, const real_t &gamma, const Grid *v) const {
+  const real_t *vd = v->_data;
+  real_t ft = vd[k] * 0.5 * (_data[k + _stride] + _data[k])
+    - vd[k - _stride] * 0.5 * (_data[k] + _data[k - _stride]);
+  real_t st = fabs(vd[k]) * 0.5 * (_data[k] - _data[k + _stride])
+    - fabs(vd[k - _stride]) * 0.5 * (_data[k - _stride] - _data[k]);
+  return (ft + gamma * st) * _sh_im1;
+}
 //------------------------------------------------------------------------------
 #endif // __GRID_HPP
@@ -107,6 +107,15 @@ InteriorIterator::InteriorIterator(const Geometry *geom)
   this->First();
 }
 
+InteriorIterator::InteriorIterator(const Geometry *geom, const index_t &first, const index_t &last)
+    : Iterator(geom){
+  // Set itermax / itermin to the first and last interior cell of the rows
+  _itmax = (_xmax*last-2);
+  _itmin = (_xmax*first+1);
+  // Set to first element
+  this->First();
+}
+
 void InteriorIterator::Next(){
   _value ++;
   if((_value + 1) % _xmax == 0){
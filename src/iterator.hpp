@@ -26,6 +26,10 @@
 ///
 /// Child classes may extend Iterator for example to restrict iteration to a
 /// certain range of cells.
+///
+/// Every neighbour access constructs a new iterator. The hot loops of the time
+/// step therefore run over plain indices row by row and use the index based
+/// stencils of Grid instead.
 class Iterator {
 public:
   /// Constructs a new Iterator constricted by the given geometry.
@@ -139,6 +143,15 @@ public:
   ///
   /// @param geom Geometry The geometry to work with
   InteriorIterator(const Geometry *geom);
+
+  /// Construct a new InteriorIterator working with the given geometry, which
+  /// only iterates over the interior cells of the rows [first, last). Loops
+  /// can be split into row ranges this way.
+  ///
+  /// @param geom Geometry The geometry to work with
+  /// @param first index_t The first row, at least 1
+  /// @param last index_t The row after the last row, at most Size()[1] - 1
+  InteriorIterator(const Geometry *geom, const index_t &first, const index_t &last);
   
   /// Goes to the next element of the iterator, disables it if position is end.
   void Next();
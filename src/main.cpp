@@ -26,9 +26,12 @@
 #include "solver.hpp"
 #include "tests.hpp"
 #include "substance.hpp"
+#include "communicator.hpp"
+#include "output.hpp"
 
 #include <iostream> // getchar()
 #include <chrono> // time functions
+#include <cstring> // memcmp(), memcpy()
 #include <string> // string functions
 #include <algorithm> // transform()
 #include <fstream> // ifstream
@@ -49,9 +52,118 @@ bool file_exists(string name) {
   return f.good();
 }
 
+/// Header of a checkpoint file. A run can only be continued with the same
+/// blocks, precision and number of substances.
+struct checkpoint_t {
+  char magic[8];
+  uint32_t real_size;
+  int32_t threads;
+  index_t size[DIM];
+  index_t n_subst;
+  int32_t step;
+  uint32_t vtk_count;
+};
+
+/// Magic number at the start of each checkpoint file
+#define CHECKPOINT_MAGIC "NUMSIMCK"
+
+/// Returns the name of the checkpoint file of this process.
+///
+/// @param comm Communicator The communicator of the run
+/// @return string The filename
+string checkpoint_name(const Communicator &comm) {
+  if (comm.ThreadCnt() > 1)
+    return "checkpoint_" + to_string(comm.ThreadNum()) + ".bin";
+  return "checkpoint.bin";
+}
+
+/// Fills the header of a checkpoint file with the current run.
+///
+/// @param header checkpoint_t The header to fill
+/// @param comm Communicator The communicator of the run
+/// @param geom Geometry The geometry of the own block
+/// @param subst Substance The substances
+/// @param stepNr int The number of the next time step
+void checkpoint_header(checkpoint_t &header, const Communicator &comm,
+                       const Geometry &geom, const Substance &subst,
+                       const int &stepNr) {
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+  header.real_size = sizeof(real_t);
+  header.threads = comm.ThreadCnt();
+  for (index_t d = 0; d < DIM; ++d)
+    header.size[d] = geom.Size()[d];
+  header.n_subst = subst.N();
+  header.step = stepNr;
+  header.vtk_count = VTK::Count();
+}
+
+/// Writes the state of the run to the checkpoint file of this process. The
+/// file is written under a temporary name first, so an interrupted write
+/// keeps the previous checkpoint.
+///
+/// @param comm Communicator The communicator of the run
+/// @param geom Geometry The geometry of the own block
+/// @param comp Compute The fluid solver
+/// @param subst Substance The substances
+/// @param stepNr int The number of the next time step
+void write_checkpoint(const Communicator &comm, const Geometry &geom,
+                      const Compute &comp, const Substance &subst,
+                      const int &stepNr) {
+  const string name = checkpoint_name(comm);
+  FILE *handle = fopen((name + ".tmp").c_str(), "wb");
+  if (!handle)
+    throw runtime_error("Failed to open " + name + ".tmp");
+
+  checkpoint_t header;
+  checkpoint_header(header, comm, geom, subst, stepNr);
+  if (fwrite(&header, sizeof(header), 1, handle) != 1)
+    throw runtime_error("Failed to write " + name);
+  comp.WriteCheckpoint(handle);
+  subst.WriteCheckpoint(handle);
+  fclose(handle);
+
+  if (rename((name + ".tmp").c_str(), name.c_str()) != 0)
+    throw runtime_error("Failed to replace " + name);
+}
+
+/// Restores the state of the run from the checkpoint file of this process.
+///
+/// @param comm Communicator The communicator of the run
+/// @param geom Geometry The geometry of the own block
+/// @param comp Compute The fluid solver
+/// @param subst Substance The substances
+/// @param stepNr int Returns the number of the next time step
+void read_checkpoint(const Communicator &comm, const Geometry &geom,
+                     Compute &comp, Substance &subst, int &stepNr) {
+  const string name = checkpoint_name(comm);
+  FILE *handle = fopen(name.c_str(), "rb");
+  if (!handle)
+    throw runtime_error("Failed to open " + name);
+
+  // Everything but the step and the output counter has to match
+  checkpoint_t header, expected;
+  if (fread(&header, sizeof(header), 1, handle) != 1)
+    throw runtime_error("Failed to read " + name);
+  checkpoint_header(expected, comm, geom, subst, header.step);
+  expected.vtk_count = header.vtk_count;
+  if (memcmp(&header, &expected, sizeof(header)) != 0)
+    throw runtime_error(name + " does not match this run");
+
+  comp.ReadCheckpoint(handle);
+  subst.ReadCheckpoint(handle);
+  fclose(handle);
+
+  stepNr = header.step;
+  VTK::SetCount(header.vtk_count);
+}
+
 /// The entry point into the simulation program. The following console para-
 /// meters are implemented:
 ///
+/// scenario <name>   Simulates the scenario in the scenarios folder
+/// restart           Continues the run from the last checkpoint
+///
 /// TEST_COMPUTE
 /// TEST_ITERATOR
 /// TEST_GEOMETRY
@@ -64,6 +176,11 @@ bool file_exists(string name) {
 /// Console parameters starting with TEST are meant to be used to test specific
 /// subsystems of the programs.
 int main(int argc, char **argv) {
+  // Start the parallel run. Only the first process prints to the console.
+  Communicator comm(&argc, &argv);
+  if (comm.ThreadNum() > 0 && !freopen("/dev/null", "w", stdout))
+    throw runtime_error(std::string("Failed to silence the output of process " + to_string(comm.ThreadNum())));
+
   // Printing stupid things to cheer the simpleminded user
   printf("             ███▄    █  █    ██  ███▄ ▄███▓  ██████  ██▓ ███▄ ▄███▓\n");
   printf("             ██ ▀█   █  ██  ▓██▒▓██▒▀█▀ ██▒▒██    ▒ ▓██▒▓██▒▀█▀ ██▒\n");
@@ -89,12 +206,17 @@ int main(int argc, char **argv) {
   Geometry geom;
   Substance subst(&geom);
   
-  // Check which scenario (if any) we want to simulate
+  // Check which scenario (if any) we want to simulate and whether the run
+  // continues from a checkpoint
   string scenarioName = "none";
+  bool restart = false;
   for (int i = 0; i < argc; i++) {
     string dc = argv[i];
     transform(dc.begin(), dc.end(), dc.begin(), ::tolower);
 
+    if (dc == "restart")
+      restart = true;
+
     if (
       dc == "scenario"
       && i < argc - 1
@@ -133,6 +255,10 @@ int main(int argc, char **argv) {
     subst.DefaultInit();
   }
   
+  // Split the domain into one block per process
+  geom.Decompose(&comm);
+  subst.Decompose();
+  
   // Create the fluid solver
   Compute comp(&geom, &param, &subst);
 
@@ -203,7 +329,9 @@ int main(int argc, char **argv) {
   CSV csv(param.Re(), csv_pos);
   
   // Create a VTK generator
-  VTK vtk(geom.Mesh(), geom.Size());
+  VTK vtk(geom.Mesh(), geom.Size(), &comm);
+  vtk.SetFormat(param.VtkFormat());
+  vtk.SetSeries(param.VtkSeries());
   
   if (OUTPUT_CSV) {
     // Create file in the CSV folder (folder must exist)
@@ -219,15 +347,31 @@ int main(int argc, char **argv) {
     delete g;
   }
 
+  // Start the output thread. The celltypes above are written before, so the
+  // numbering of the VTK files is unchanged
+  Output output(&geom, subst.N(), OUTPUT_CSV ? &csv : NULL,
+                OUTPUT_VTK ? &vtk : NULL);
+
   const Grid *visugrid;
   bool run   = true;
   bool print = true;
 
-  visugrid = comp.GetVelocity();
-
   // Let's count the number of timesteps
   int stepNr = 1;
 
+  // Count the outputs to write a checkpoint after every few of them
+  index_t outputs = 0;
+
+  // Continue a previous run. Its last output was written before its
+  // checkpoint, so the first output comes after the next time step.
+  if (restart) {
+    read_checkpoint(comm, geom, comp, subst, stepNr);
+    printf("Continuing at time %f with time step %i\n", comp.GetTime(), stepNr);
+    print = false;
+  }
+
+  visugrid = comp.GetVelocity();
+
   // Run the time steps until the end is reached
   while ((param.Tend() - comp.GetTime() > DT_MIN) && run) {
 
@@ -277,38 +421,15 @@ int main(int argc, char **argv) {
     
     if (print){
       
-      // Print CSV output in the folder CSV (must exist)
-      if (OUTPUT_CSV) {
-        // Add an entry to the CSV file (must exist)
-        csv.AddEntry(comp.GetTime(), comp.GetU(), comp.GetV(), comp.GetP());
-      }
-      
-      // Print VTK output in the folder VTK (must exist)
-      if (OUTPUT_VTK) {
-        vtk.Init("VTK/field");
-        vtk.AddField("Velocity", comp.GetU(), comp.GetV());
-        vtk.AddScalar("Pressure", comp.GetP());
-        vtk.AddScalar("Stream", comp.GetStream());
-        vtk.AddScalar("Vorticity", comp.GetVorticity());
-        string label = "Substance ";
-        for (index_t cc=0; cc<subst.N(); ++cc)
-          vtk.AddScalar((label + to_string(cc)).c_str(), subst.GetC(cc));
-        vtk.Finish();
-        
-        // Create VTK File for particles of the streakline
-        // in the folder VTK (must exist)
-        if (comp.GetStreaklines()->size() > 0) {
-          vtk.InitParticles("VTK/streaks");
-          vtk.AddParticles(comp.GetStreaklines());
-          vtk.FinishParticles();
-        }
-        
-        // Create VTK File for particles of the streakline
-        if (comp.GetParticleTracing()->size() > 0) {
-          vtk.InitParticles("VTK/traces");
-          vtk.AddParticles(comp.GetParticleTracing());
-          vtk.FinishParticles();
-        }
+      // Queue the CSV entry and the VTK files in the folders CSV and VTK
+      // (must exist), they are written while the time steps continue
+      output.Snapshot(&comp, &subst);
+
+      // Save the state after every few outputs. The output is finished
+      // first, so the checkpoint continues the numbering of the files.
+      if (param.Checkpoint() > 0 && ++outputs % param.Checkpoint() == 0) {
+        output.Wait();
+        write_checkpoint(comm, geom, comp, subst, stepNr);
       }
       
     } //end if (print)
@@ -318,42 +439,14 @@ int main(int argc, char **argv) {
     stepNr++;
   }
   
-  // Print CSV output in the folder CSV (must exist)
+  // Queue the output of the final state and wait until everything is written
+  output.Snapshot(&comp, &subst);
+  output.Wait();
+  
+  // Finish CSV
   if (OUTPUT_CSV) {
-    // Add an entry to the CSV file (must exist)
-    csv.AddEntry(comp.GetTime(), comp.GetU(), comp.GetV(), comp.GetP());
-    
-    // Finish CSV
     csv.Finish();
   }
-  
-  // Print VTK output in the folder VTK (must exist)
-  if (OUTPUT_VTK) {
-    vtk.Init("VTK/field");
-    vtk.AddField("Velocity", comp.GetU(), comp.GetV());
-    vtk.AddScalar("Pressure", comp.GetP());
-    vtk.AddScalar("Stream", comp.GetStream());
-    vtk.AddScalar("Vorticity", comp.GetVorticity());
-    string label = "Substance ";
-    for (index_t cc=0; cc<subst.N(); ++cc)
-      vtk.AddScalar((label + to_string(cc)).c_str(), subst.GetC(cc));
-    vtk.Finish();
-    
-    // Create VTK File for particles of the streakline
-    // in the folder VTK (must exist)
-    if (comp.GetStreaklines()->size() > 0) {
-      vtk.InitParticles("VTK/streaks");
-      vtk.AddParticles(comp.GetStreaklines());
-      vtk.FinishParticles();
-    }
-    
-    // Create VTK File for particles of the streakline
-    if (comp.GetParticleTracing()->size() > 0) {
-      vtk.InitParticles("VTK/traces");
-      vtk.AddParticles(comp.GetParticleTracing());
-      vtk.FinishParticles();
-    }
-  }
 
   if (MEASURE_TIME) {
     end = std::chrono::duration_cast<std::chrono::milliseconds>(
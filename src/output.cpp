@@ -0,0 +1,149 @@
+#include "typedef.hpp"
+#include "output.hpp"
+#include "compute.hpp"
+#include "csv.hpp"
+#include "grid.hpp"
+#include "substance.hpp"
+#include "vtk.hpp"
+
+#include <string>
+
+using namespace std;
+
+/// Number of snapshot buffers. With two buffers one snapshot is written while
+/// the next one is filled.
+#define OUTPUT_BUFFERS 2
+
+Output::Output(const Geometry *geom, const index_t &n_subst, CSV *csv, VTK *vtk)
+    : _n_subst(n_subst), _csv(csv), _vtk(vtk), _stop(false) {
+  _buffer = new snapshot_t[OUTPUT_BUFFERS];
+  for (index_t b = 0; b < OUTPUT_BUFFERS; ++b) {
+    _buffer[b].u = new Grid(geom);
+    _buffer[b].v = new Grid(geom);
+    _buffer[b].p = new Grid(geom);
+    _buffer[b].stream = new Grid(geom);
+    _buffer[b].vort = new Grid(geom);
+    _buffer[b].c = new Grid *[_n_subst];
+    for (index_t cc = 0; cc < _n_subst; ++cc)
+      _buffer[b].c[cc] = new Grid(geom);
+    _free.push(b);
+  }
+
+  _thread = thread(&Output::Run, this);
+}
+
+Output::~Output() {
+  {
+    lock_guard<mutex> lock(_mutex);
+    _stop = true;
+  }
+  _cond.notify_all();
+  _thread.join();
+
+  for (index_t b = 0; b < OUTPUT_BUFFERS; ++b) {
+    delete _buffer[b].u;
+    delete _buffer[b].v;
+    delete _buffer[b].p;
+    delete _buffer[b].stream;
+    delete _buffer[b].vort;
+    for (index_t cc = 0; cc < _n_subst; ++cc)
+      delete _buffer[b].c[cc];
+    delete[] _buffer[b].c;
+  }
+  delete[] _buffer;
+}
+
+void Output::Snapshot(Compute *comp, const Substance *subst) {
+  if (!_csv && !_vtk)
+    return;
+
+  index_t b;
+  {
+    unique_lock<mutex> lock(_mutex);
+    _cond.wait(lock, [this] { return !_free.empty(); });
+    b = _free.front();
+    _free.pop();
+  }
+
+  // The writer thread does not touch this buffer until it is queued
+  snapshot_t &snap = _buffer[b];
+  snap.time = comp->GetTime();
+  snap.u->CopyFrom(comp->GetU());
+  snap.v->CopyFrom(comp->GetV());
+  snap.p->CopyFrom(comp->GetP());
+  if (_vtk) {
+    // Both fields communicate with the neighbouring blocks, so they are
+    // computed here and not by the writer thread
+    comp->UpdateDerived(DerivedField::Derived_Stream |
+                        DerivedField::Derived_Vorticity);
+    snap.stream->CopyFrom(comp->GetStream());
+    snap.vort->CopyFrom(comp->GetVorticity());
+    for (index_t cc = 0; cc < _n_subst; ++cc)
+      snap.c[cc]->CopyFrom(subst->GetC(cc));
+    snap.streaks = *comp->GetStreaklines();
+    snap.traces = *comp->GetParticleTracing();
+  }
+
+  {
+    lock_guard<mutex> lock(_mutex);
+    _queue.push(b);
+  }
+  _cond.notify_all();
+}
+
+void Output::Wait() {
+  unique_lock<mutex> lock(_mutex);
+  _cond.wait(lock, [this] { return _queue.empty(); });
+}
+
+void Output::Run() {
+  unique_lock<mutex> lock(_mutex);
+  while (true) {
+    _cond.wait(lock, [this] { return !_queue.empty() || _stop; });
+    if (_queue.empty())
+      break;
+
+    // Write without holding the lock, so the next snapshot can be filled
+    const index_t b = _queue.front();
+    lock.unlock();
+    this->Write(_buffer[b]);
+    lock.lock();
+
+    _queue.pop();
+    _free.push(b);
+    _cond.notify_all();
+  }
+}
+
+void Output::Write(const snapshot_t &snap) {
+  // Add an entry to the CSV file
+  if (_csv)
+    _csv->AddEntry(snap.time, snap.u, snap.v, snap.p);
+
+  if (!_vtk)
+    return;
+
+  _vtk->Init("VTK/field", snap.time);
+  _vtk->AddField("Velocity", snap.u, snap.v);
+  _vtk->AddScalar("Pressure", snap.p);
+  _vtk->AddScalar("Stream", snap.stream);
+  _vtk->AddScalar("Vorticity", snap.vort);
+  string label = "Substance ";
+  for (index_t cc = 0; cc < _n_subst; ++cc)
+    _vtk->AddScalar((label + to_string(cc)).c_str(), snap.c[cc]);
+  _vtk->Finish();
+
+  // Create VTK File for particles of the streakline
+  if (snap.streaks.Size() > 0) {
+    _vtk->InitParticles("VTK/streaks");
+    _vtk->AddParticles(&snap.streaks);
+    _vtk->FinishParticles();
+  }
+
+  // Create VTK File for particles of the particle tracing
+  if (snap.traces.Size() > 0) {
+    _vtk->InitParticles("VTK/traces");
+    _vtk->AddParticles(&snap.traces);
+    _vtk->FinishParticles();
+  }
+}
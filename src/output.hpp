@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2015   Malte Brunn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//------------------------------------------------------------------------------
+#include "typedef.hpp"
+#include "particles.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+//------------------------------------------------------------------------------
+#ifndef __OUTPUT_HPP
+#define __OUTPUT_HPP
+//------------------------------------------------------------------------------
+
+/// Writes the CSV entries and VTK files of the simulation in a background
+/// thread. At an output step the fields are copied into a free snapshot
+/// buffer and the time stepping continues while the thread writes them. If
+/// all buffers are still waiting to be written, the next snapshot waits for
+/// the thread, so the simulation never runs ahead by more than the number of
+/// buffers.
+///
+/// The thread only writes files. Fields that need communication between the
+/// processes, like the stream function, are computed by the calling thread.
+class Output {
+public:
+  /// Constructs the buffers and starts the writer thread.
+  ///
+  /// @param geom Geometry The geometry of the fields
+  /// @param n_subst index_t The number of substances
+  /// @param csv CSV* The CSV file to add entries to or NULL for none
+  /// @param vtk VTK* The VTK generator for the fields and particles or NULL
+  ///   for none
+  Output(const Geometry *geom, const index_t &n_subst, CSV *csv, VTK *vtk);
+
+  /// Writes the remaining snapshots and stops the writer thread.
+  ~Output();
+
+  /// Copies the current fields and particles into a free buffer and queues it
+  /// for writing. Waits for the writer thread if no buffer is free.
+  ///
+  /// @param comp Compute The computation holding the fields
+  /// @param subst Substance The substance concentrations
+  void Snapshot(Compute *comp, const Substance *subst);
+
+  /// Waits until all queued snapshots are written.
+  void Wait();
+
+private:
+  /// The copy of one output step
+  struct snapshot_t {
+    real_t time;
+    Grid *u;
+    Grid *v;
+    Grid *p;
+    Grid *stream;
+    Grid *vort;
+    Grid **c;
+    Particles streaks;
+    Particles traces;
+  };
+
+  /// _n_subst index_t The number of substances
+  index_t _n_subst;
+
+  /// _csv CSV* The CSV file or NULL
+  CSV *_csv;
+
+  /// _vtk VTK* The VTK generator or NULL
+  VTK *_vtk;
+
+  /// _buffer snapshot_t* The snapshot buffers
+  snapshot_t *_buffer;
+
+  /// _free queue<index_t> The buffers that can be filled
+  std::queue<index_t> _free;
+
+  /// _queue queue<index_t> The filled buffers in the order of writing. The
+  ///   front buffer is removed once it is written
+  std::queue<index_t> _queue;
+
+  /// _stop bool True if the writer thread ends after the queued snapshots
+  bool _stop;
+
+  /// _mutex mutex Guards the queues and _stop
+  std::mutex _mutex;
+
+  /// _cond condition_variable Signals changes of the queues and _stop
+  std::condition_variable _cond;
+
+  /// _thread thread The writer thread
+  std::thread _thread;
+
+  /// Writes the queued snapshots until the output is stopped.
+  void Run();
+
+  /// Writes one snapshot to the CSV and VTK files.
+  ///
+  /// @param snap snapshot_t The snapshot
+  void Write(const snapshot_t &snap);
+};
+//------------------------------------------------------------------------------
+#endif // __OUTPUT_HPP
@@ -17,6 +17,17 @@ Parameter::Parameter(){
   _itermax = 1e2;
   _dt      = 0.1;
   _tend    = 10;
+  _solver  = SolverType::SOR_Lexicographic;
+  _precond = PreconditionerType::Precond_IC;
+  _direct  = 1;
+  _vtkformat = VTKFormat::VTK_ASCII;
+  _vtkseries = 0;
+  _checkpoint = 0;
+  _rescheck = 1;
+  _predictor = 0;
+  _rhsskip = 0.0;
+  _integrator = 1;
+  _pcfl = 1.0;
   
   // Compute inverse Re
   _invre   = 1.0/_re;
@@ -39,6 +50,17 @@ void Parameter::Load(const char *file) {
     else if (strcmp(name,"eps") == 0) _eps = inval;
     else if (strcmp(name,"tau") == 0) _tau = inval;
     else if (strcmp(name,"dtfix") == 0) _dt_fixed = inval;
+    else if (strcmp(name,"solver") == 0) _solver = inval;
+    else if (strcmp(name,"precond") == 0) _precond = inval;
+    else if (strcmp(name,"direct") == 0) _direct = inval;
+    else if (strcmp(name,"vtkformat") == 0) _vtkformat = inval;
+    else if (strcmp(name,"vtkseries") == 0) _vtkseries = inval;
+    else if (strcmp(name,"checkpoint") == 0) _checkpoint = inval;
+    else if (strcmp(name,"rescheck") == 0) _rescheck = inval;
+    else if (strcmp(name,"predictor") == 0) _predictor = inval;
+    else if (strcmp(name,"rhsskip") == 0) _rhsskip = inval;
+    else if (strcmp(name,"integrator") == 0) _integrator = inval;
+    else if (strcmp(name,"pcfl") == 0) _pcfl = inval;
     else printf("Unknown parameter %s\n",name);
   }
   fclose(handle);
@@ -82,4 +104,48 @@ const real_t &Parameter::Tau() const{
 
 const real_t &Parameter::FixedDt() const{
   return _dt_fixed;
-}
\ No newline at end of file
+}
+
+const index_t &Parameter::SolverId() const{
+  return _solver;
+}
+
+const index_t &Parameter::Precond() const{
+  return _precond;
+}
+
+const index_t &Parameter::Direct() const{
+  return _direct;
+}
+
+const index_t &Parameter::VtkFormat() const{
+  return _vtkformat;
+}
+
+const index_t &Parameter::VtkSeries() const{
+  return _vtkseries;
+}
+
+const index_t &Parameter::Checkpoint() const{
+  return _checkpoint;
+}
+
+const index_t &Parameter::ResCheck() const{
+  return _rescheck;
+}
+
+const index_t &Parameter::Predictor() const{
+  return _predictor;
+}
+
+const real_t &Parameter::RhsSkip() const{
+  return _rhsskip;
+}
+
+const index_t &Parameter::Integrator() const{
+  return _integrator;
+}
+
+const real_t &Parameter::ParticleCfl() const{
+  return _pcfl;
+}
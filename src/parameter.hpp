@@ -82,6 +82,76 @@ public:
   /// @return real_t The fixed timestep width to output to CSV
   const real_t &FixedDt() const;
 
+  /// Returns the type of the pressure solver.
+  ///
+  /// @see Enum SolverType
+  /// @return index_t The type of the pressure solver
+  const index_t &SolverId() const;
+
+  /// Returns the type of the preconditioner of the PCG solver.
+  ///
+  /// @see Enum PreconditionerType
+  /// @return index_t The type of the preconditioner
+  const index_t &Precond() const;
+
+  /// Returns whether the direct FFT solver replaces the selected solver on
+  /// geometries it can handle.
+  ///
+  /// @see FFTSolver::Applicable
+  /// @return index_t 1 if the direct solver is used automatically, 0 if not
+  const index_t &Direct() const;
+
+  /// Returns the encoding of the VTK files.
+  ///
+  /// @see Enum VTKFormat
+  /// @return index_t The encoding of the VTK files
+  const index_t &VtkFormat() const;
+
+  /// Returns whether the VTK files are written as image data without point
+  /// coordinates.
+  ///
+  /// @see VTK::SetSeries
+  /// @return index_t 1 for image data, 0 for structured grids
+  const index_t &VtkSeries() const;
+
+  /// Returns after how many outputs a checkpoint is written.
+  ///
+  /// @return index_t The number of outputs between checkpoints, 0 for none
+  const index_t &Checkpoint() const;
+
+  /// Returns after how many cycles of the pressure solver the residual is
+  /// checked.
+  ///
+  /// @return index_t The number of cycles between residual checks, 0 to
+  ///   choose it from the observed convergence
+  const index_t &ResCheck() const;
+
+  /// Returns the order of the extrapolation of the pressure of the last time
+  /// steps, which is the initial guess of the pressure solver.
+  ///
+  /// @return index_t 0 to start from the last pressure, 1 for linear and 2
+  ///   for quadratic extrapolation
+  const index_t &Predictor() const;
+
+  /// Returns the relative change of the RHS below which the pressure is not
+  /// solved again.
+  ///
+  /// @return real_t The threshold, 0 to solve in every time step
+  const real_t &RhsSkip() const;
+
+  /// Returns the order of the Runge-Kutta scheme that moves the particles.
+  ///
+  /// @return index_t 1 for explicit Euler with the velocities at the end of
+  ///   the time step, 2 for the midpoint rule and 4 for the classical
+  ///   Runge-Kutta scheme
+  const index_t &Integrator() const;
+
+  /// Returns how many cells a particle may cross at most in one sub-step of
+  /// the Runge-Kutta schemes of order 2 and 4.
+  ///
+  /// @return real_t The number of cells per sub-step
+  const real_t &ParticleCfl() const;
+
 private:
   /// _re real_t The reynolds number
   real_t _re;
@@ -112,6 +182,41 @@ private:
 
   /// _itermax index_t The maximum number of iterations of the solver
   index_t _itermax;
+
+  /// _solver index_t The type of the pressure solver
+  index_t _solver;
+
+  /// _precond index_t The type of the preconditioner of the PCG solver
+  index_t _precond;
+
+  /// _direct index_t 1 if the direct FFT solver is used automatically
+  index_t _direct;
+
+  /// _vtkformat index_t The encoding of the VTK files
+  index_t _vtkformat;
+
+  /// _vtkseries index_t 1 if the VTK files are written as image data
+  index_t _vtkseries;
+
+  /// _checkpoint index_t The number of outputs between checkpoints
+  index_t _checkpoint;
+
+  /// _rescheck index_t The number of solver cycles between residual checks
+  index_t _rescheck;
+
+  /// _predictor index_t The order of the pressure extrapolation
+  index_t _predictor;
+
+  /// _rhsskip real_t The relative change of the RHS below which the pressure
+  ///   solve is skipped
+  real_t _rhsskip;
+
+  /// _integrator index_t The order of the particle integrator
+  index_t _integrator;
+
+  /// _pcfl real_t The number of cells a particle crosses at most in one
+  ///   sub-step
+  real_t _pcfl;
 };
 //------------------------------------------------------------------------------
 #endif // __PARAMETER_HPP
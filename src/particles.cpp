@@ -0,0 +1,153 @@
+#include "typedef.hpp"
+#include "particles.hpp"
+
+using namespace std;
+
+/// Head of a line whose newest particle was removed
+#define PARTICLES_NO_HEAD index_t(-1)
+
+Particles::Particles() {}
+
+void Particles::Clear() {
+  _x.clear();
+  _y.clear();
+  _line.clear();
+  _alive.clear();
+  _head.clear();
+}
+
+void Particles::AddLine(const real_t &x, const real_t &y, const bool &alive) {
+  _head.push_back(PARTICLES_NO_HEAD);
+  this->Add(_head.size() - 1, x, y, alive);
+}
+
+void Particles::Add(const index_t &line, const real_t &x, const real_t &y, const bool &alive) {
+  _head[line] = _x.size();
+  _x.push_back(x);
+  _y.push_back(y);
+  _line.push_back(line);
+  _alive.push_back(alive);
+}
+
+void Particles::Append(const index_t &n, const index_t *line, const real_t *x,
+                       const real_t *y, const char *alive) {
+  const index_t first = _x.size();
+  _x.resize(first + n);
+  _y.resize(first + n);
+  _line.resize(first + n);
+  _alive.resize(first + n);
+
+  OMP_FOR
+  for (index_t i = 0; i < n; ++i) {
+    _x[first + i]     = x[i];
+    _y[first + i]     = y[i];
+    _line[first + i]  = line[i];
+    _alive[first + i] = alive[i];
+    _head[line[i]]    = first + i;
+  }
+}
+
+void Particles::Compact() {
+  const index_t n = _x.size();
+  index_t kept = 0;
+
+  for (index_t i = 0; i < n; ++i) {
+    const index_t line = _line[i];
+
+    if (!_alive[i]) {
+      if (_head[line] == i)
+        _head[line] = PARTICLES_NO_HEAD;
+      continue;
+    }
+
+    if (_head[line] == i)
+      _head[line] = kept;
+
+    _x[kept]     = _x[i];
+    _y[kept]     = _y[i];
+    _line[kept]  = line;
+    _alive[kept] = 1;
+    ++kept;
+  }
+
+  _x.resize(kept);
+  _y.resize(kept);
+  _line.resize(kept);
+  _alive.resize(kept);
+}
+
+index_t Particles::Size() const {
+  return _x.size();
+}
+
+index_t Particles::Lines() const {
+  return _head.size();
+}
+
+bool Particles::Active(const index_t &line) const {
+  return _head[line] != PARTICLES_NO_HEAD && _alive[_head[line]];
+}
+
+index_t Particles::Head(const index_t &line) const {
+  return _head[line];
+}
+
+real_t *Particles::X() {
+  return _x.data();
+}
+
+const real_t *Particles::X() const {
+  return _x.data();
+}
+
+real_t *Particles::Y() {
+  return _y.data();
+}
+
+const real_t *Particles::Y() const {
+  return _y.data();
+}
+
+const index_t *Particles::Line() const {
+  return _line.data();
+}
+
+char *Particles::Alive() {
+  return _alive.data();
+}
+
+const char *Particles::Alive() const {
+  return _alive.data();
+}
+
+void Particles::Write(FILE *handle) const {
+  // The number of lines and particles followed by the arrays
+  uint64_t n[2] = {_head.size(), _x.size()};
+  bool ok = fwrite(n, sizeof(n[0]), 2, handle) == 2;
+  ok = ok && fwrite(_head.data(), sizeof(index_t), n[0], handle) == n[0];
+  ok = ok && fwrite(_x.data(), sizeof(real_t), n[1], handle) == n[1];
+  ok = ok && fwrite(_y.data(), sizeof(real_t), n[1], handle) == n[1];
+  ok = ok && fwrite(_line.data(), sizeof(index_t), n[1], handle) == n[1];
+  ok = ok && fwrite(_alive.data(), sizeof(char), n[1], handle) == n[1];
+  if (!ok)
+    throw runtime_error("Failed to write the particles!");
+}
+
+void Particles::Read(FILE *handle) {
+  uint64_t n[2];
+  bool ok = fread(n, sizeof(n[0]), 2, handle) == 2;
+  if (ok) {
+    _head.resize(n[0]);
+    _x.resize(n[1]);
+    _y.resize(n[1]);
+    _line.resize(n[1]);
+    _alive.resize(n[1]);
+  }
+  ok = ok && fread(_head.data(), sizeof(index_t), n[0], handle) == n[0];
+  ok = ok && fread(_x.data(), sizeof(real_t), n[1], handle) == n[1];
+  ok = ok && fread(_y.data(), sizeof(real_t), n[1], handle) == n[1];
+  ok = ok && fread(_line.data(), sizeof(index_t), n[1], handle) == n[1];
+  ok = ok && fread(_alive.data(), sizeof(char), n[1], handle) == n[1];
+  if (!ok)
+    throw runtime_error("Failed to read the particles!");
+}
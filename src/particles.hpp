@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2015   Malte Brunn
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//------------------------------------------------------------------------------
+#include "typedef.hpp"
+
+#include <vector>
+//------------------------------------------------------------------------------
+#ifndef __PARTICLES_HPP
+#define __PARTICLES_HPP
+//------------------------------------------------------------------------------
+
+/// The particles of several lines, like streaklines or particle traces, as a
+/// structure of arrays. The coordinates, the line and the alive flag of each
+/// particle are stored in contiguous arrays, so moving all particles is a
+/// single loop without allocations.
+///
+/// New particles are appended at the end. The particles of one line are thus
+/// ordered by the time they were added, while the lines are interleaved. The
+/// newest particle of a line is its head. A line is active as long as its
+/// head is alive.
+class Particles {
+public:
+  /// Constructs an empty set of lines.
+  Particles();
+
+  /// Removes all particles and lines.
+  void Clear();
+
+  /// Starts a new line with the given particle as its head.
+  ///
+  /// @param x real_t The x coordinate of the particle
+  /// @param y real_t The y coordinate of the particle
+  /// @param alive bool Whether the particle is alive
+  void AddLine(const real_t &x, const real_t &y, const bool &alive);
+
+  /// Appends a particle to a line and makes it the head of the line.
+  ///
+  /// @param line index_t The line
+  /// @param x real_t The x coordinate of the particle
+  /// @param y real_t The y coordinate of the particle
+  /// @param alive bool Whether the particle is alive
+  void Add(const index_t &line, const real_t &x, const real_t &y, const bool &alive);
+
+  /// Appends one particle to each of the given lines, like Add in the order
+  /// of the lines. The arrays grow once and are filled in parallel, so the
+  /// lines must be distinct.
+  ///
+  /// @param n index_t The number of particles
+  /// @param line index_t* The line of each particle
+  /// @param x real_t* The x coordinates of the particles
+  /// @param y real_t* The y coordinates of the particles
+  /// @param alive char* Whether each particle is alive
+  void Append(const index_t &n, const index_t *line, const real_t *x,
+              const real_t *y, const char *alive);
+
+  /// Removes the particles that are not alive. The order of the remaining
+  /// particles is kept. Lines whose head is removed become inactive.
+  void Compact();
+
+  /// Returns the number of particles of all lines.
+  ///
+  /// @return index_t The number of particles
+  index_t Size() const;
+
+  /// Returns the number of lines.
+  ///
+  /// @return index_t The number of lines
+  index_t Lines() const;
+
+  /// Returns whether the head of the given line is alive.
+  ///
+  /// @param line index_t The line
+  /// @return bool True if the line is active
+  bool Active(const index_t &line) const;
+
+  /// Returns the index of the head of the given line. Only valid for active
+  /// lines.
+  ///
+  /// @param line index_t The line
+  /// @return index_t The index of the newest particle of the line
+  index_t Head(const index_t &line) const;
+
+  /// Returns the x coordinates of the particles.
+  ///
+  /// @return real_t* The x coordinates
+  real_t *X();
+
+  /// Returns the x coordinates for read access.
+  ///
+  /// @return real_t* The x coordinates
+  const real_t *X() const;
+
+  /// Returns the y coordinates of the particles.
+  ///
+  /// @return real_t* The y coordinates
+  real_t *Y();
+
+  /// Returns the y coordinates for read access.
+  ///
+  /// @return real_t* The y coordinates
+  const real_t *Y() const;
+
+  /// Returns the line of each particle.
+  ///
+  /// @return index_t* The lines
+  const index_t *Line() const;
+
+  /// Returns the alive flag of each particle. Particles that are not alive
+  /// are not moved anymore.
+  ///
+  /// @return char* The alive flags
+  char *Alive();
+
+  /// Returns the alive flags for read access.
+  ///
+  /// @return char* The alive flags
+  const char *Alive() const;
+
+  /// Writes the particles and lines to a checkpoint.
+  ///
+  /// @param handle FILE* The opened checkpoint file
+  void Write(FILE *handle) const;
+
+  /// Reads particles and lines written by Write.
+  ///
+  /// @param handle FILE* The opened checkpoint file
+  void Read(FILE *handle);
+
+private:
+  /// _x vector<real_t> The x coordinate of each particle
+  std::vector<real_t> _x;
+
+  /// _y vector<real_t> The y coordinate of each particle
+  std::vector<real_t> _y;
+
+  /// _line vector<index_t> The line of each particle
+  std::vector<index_t> _line;
+
+  /// _alive vector<char> 1 for particles that are still moved, else 0
+  std::vector<char> _alive;
+
+  /// _head vector<index_t> The newest particle of each line or index_t(-1)
+  ///   once it was removed
+  std::vector<index_t> _head;
+};
+//------------------------------------------------------------------------------
+#endif // __PARTICLES_HPP
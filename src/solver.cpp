@@ -3,11 +3,34 @@
 #include "geometry.hpp"
 #include "grid.hpp"
 #include "iterator.hpp"
+#include "communicator.hpp"
 
 #include <cmath>
+#include <cstring> // memset
+#include <complex>
 
 using namespace std;
 
+/// Number of smoothing sweeps before and after the coarse grid correction
+#define MG_PRE_SWEEPS 2
+#define MG_POST_SWEEPS 2
+
+/// Upper bound on the number of smoothing sweeps on the coarsest level
+#define MG_COARSE_SWEEPS 1000
+
+/// Maximum number of entries of the residual history printed by PCG::Report
+#define PCG_REPORT_ENTRIES 10
+
+/// Range of the adapted omega of the SOR solvers
+#define SOR_OMEGA_MIN 1.0
+#define SOR_OMEGA_MAX 1.99
+
+/// A contraction up to this factor times omega - 1 is taken as a sign that
+/// omega is above the optimum, which then lowers omega - 1 by SOR_BACKOFF.
+/// A growing residual lowers the upper bound of omega the same way.
+#define SOR_ABOVE_OPTIMUM 1.05
+#define SOR_BACKOFF 0.95
+
 Solver::Solver(const Geometry *geom) : _geom(geom) {
   _hsquare =  (pow(_geom->Mesh()[0],2.0) * pow(_geom->Mesh()[1],2.0))
     / ( 2.0 * (pow(_geom->Mesh()[0],2.0) + pow(_geom->Mesh()[1],2.0)));
@@ -16,11 +39,29 @@ Solver::Solver(const Geometry *geom) : _geom(geom) {
 
   _sh_ism0 = 1.0 / pow(_geom->Mesh()[0], 2.0);
   _sh_ism1 = 1.0 / pow(_geom->Mesh()[1], 2.0);
+
+  _stride = _geom->Size()[0];
 }
 
 Solver::~Solver(){
 }
 
+index_t Solver::Smooth(Grid *, const Grid *, const index_t &) const {
+  return 0;
+}
+
+void Solver::Report() const {
+}
+
+void Solver::Adapt(const real_t &) {
+}
+
+void Solver::WriteCheckpoint(FILE *) const {
+}
+
+void Solver::ReadCheckpoint(FILE *) {
+}
+
 real_t Solver::localRes(const Iterator &it, const Grid *grid, const Grid *rhs) const {
   return (
     (grid->Cell(it.Left()) + grid->Cell(it.Right())) * _sh_ism0
@@ -30,41 +71,1287 @@ real_t Solver::localRes(const Iterator &it, const Grid *grid, const Grid *rhs) c
   );
 }
 
+real_t Solver::totalRes(Grid *grid, const Grid *rhs) const {
+  _geom->Update_P(grid);
+
+  const index_t nx = _geom->Size()[0];
+  const index_t ny = _geom->Size()[1];
+  const char *cells = _geom->GetCells();
+
+  const real_t *p = grid->Data();
+  const real_t *f = rhs->Data();
+
+  accum_t total(0.0);
+  index_t n(0);
+
+  for (index_t j = 1; j < ny - 1; ++j) {
+    for (index_t k = j * nx + 1; k < j * nx + nx - 1; ++k) {
+      if (cells[k] != CellType::Fluid)
+        continue;
+
+      const real_t lres = this->localRes(k, p, f);
+      total += lres * lres;
+      n     += 1;
+    }
+  }
+
+  return sqrt(total / n);
+}
+
 
 /***************************************************************************
  *                                    SOR                                  *
  ***************************************************************************/
 
-SOR::SOR(const Geometry *geom, const real_t &omega) : Solver(geom), _omega(omega) {
-  /// @TODO choose omega mesh width specific -> Script
-  printf("Omega given: %f, omega computed: %f, %f\n",
-    _omega,
-    2/(1+sin(M_PI*_geom->Mesh()[0])),
-    2/(1+sin(M_PI*_geom->Mesh()[1]))
-  );
+SOR::SOR(const Geometry *geom, const real_t &omega)
+    : Solver(geom), _omega(omega), _omega_max(SOR_OMEGA_MAX), _adapt(false) {
+  if (_omega > 0.0) {
+    printf("Omega given: %f\n", _omega);
+    return;
+  }
+
+  bool exact;
+  _omega = OptimalOmega(_geom, exact);
+  _adapt = !exact;
+  printf("Omega computed: %f%s\n", _omega, _adapt ? ", adapted during the run" : "");
 }
 
 SOR::~SOR(){
 }
 
 real_t SOR::Cycle(Grid *grid, const Grid *rhs) const {
-  InteriorIterator init(_geom);
-  
-  real_t  totalRes(0.0);
+  const index_t *seg   = _geom->FluidSegments();
+  const index_t  n_seg = _geom->NFluidSegments();
+
+  real_t       *p = grid->Data();
+  const real_t *f = rhs->Data();
+
+  accum_t totalRes(0.0);
   index_t n_avg(0);
   
-  for (init.First(); init.Valid(); init.Next()) {
-    // Skip obstacles
-    if (_geom->CellTypeAt(init) != CellType::Fluid)
-      continue;
-    
-    real_t localRes = this->localRes(init, grid, rhs);
-    grid->Cell(init) = grid->Cell(init) + _omega * _hsquare * localRes;
-    
-    // Compute total residual
-    totalRes += pow(localRes, 2.0);
-    n_avg    += 1;
+  // The segments only contain fluid cells, obstacles are skipped
+  for (index_t s = 0; s < n_seg; ++s) {
+    for (index_t k = seg[2 * s]; k < seg[2 * s + 1]; ++k) {
+      real_t localRes = this->localRes(k, p, f);
+      p[k] = p[k] + _omega * _hsquare * localRes;
+
+      // Compute total residual
+      totalRes += localRes * localRes;
+    }
+    n_avg += seg[2 * s + 1] - seg[2 * s];
   }
   
   return sqrt(totalRes / n_avg);
+}
+
+void SOR::Adapt(const real_t &rate) {
+  if (!_adapt || rate <= 0.0)
+    return;
+
+  // The ghost cells of obstacles lag behind the sweep, which lets the
+  // iteration diverge below the theoretical bound. Omega stays below the
+  // values that diverged.
+  if (rate >= 1.0)
+    _omega_max = 1.0 + (_omega - 1.0) * SOR_BACKOFF;
+
+  if (rate >= 1.0 || rate <= (_omega - 1.0) * SOR_ABOVE_OPTIMUM) {
+    _omega = 1.0 + (_omega - 1.0) * SOR_BACKOFF;
+  } else {
+    // The spectral radius of the Jacobi iteration belonging to the rate
+    const real_t mu2 = (rate + _omega - 1.0) * (rate + _omega - 1.0) / (rate * _omega * _omega);
+    if (mu2 >= 1.0)
+      return;
+    _omega = 2.0 / (1.0 + sqrt(1.0 - mu2));
+  }
+
+  _omega = min(max(_omega, real_t(SOR_OMEGA_MIN)), _omega_max);
+}
+
+void SOR::WriteCheckpoint(FILE *handle) const {
+  if (fwrite(&_omega, sizeof(_omega), 1, handle) != 1 ||
+      fwrite(&_omega_max, sizeof(_omega_max), 1, handle) != 1)
+    throw std::runtime_error("Failed to write the checkpoint!");
+}
+
+void SOR::ReadCheckpoint(FILE *handle) {
+  if (fread(&_omega, sizeof(_omega), 1, handle) != 1 ||
+      fread(&_omega_max, sizeof(_omega_max), 1, handle) != 1)
+    throw std::runtime_error("Failed to read the checkpoint!");
+}
+
+real_t SOR::OptimalOmega(const Geometry *geom, bool &exact) {
+  const real_t wx = 1.0 / pow(geom->Mesh()[0], 2.0);
+  const real_t wy = 1.0 / pow(geom->Mesh()[1], 2.0);
+
+  // Number of Dirichlet sides in x and y direction. A block of a parallel run
+  // does not know the boundaries of the other blocks.
+  exact = geom->Comm()->ThreadCnt() == 1 && FFTSolver::Applicable(geom);
+  index_t dx(2), dy(2);
+  if (exact) {
+    dx = (geom->PBoundaryType(4) == 1) + (geom->PBoundaryType(2) == 1);
+    dy = (geom->PBoundaryType(1) == 1) + (geom->PBoundaryType(3) == 1);
+  }
+
+  // Eigenvalues of the 1D Jacobi iteration of the lowest two modes. Two
+  // Neumann sides allow the constant mode, one Dirichlet side shifts the
+  // modes by a quarter wave.
+  real_t cx[2], cy[2];
+  const index_t n[2] = {geom->TotalSize()[0] - 2, geom->TotalSize()[1] - 2};
+  const index_t d[2] = {dx, dy};
+  real_t *c[2] = {cx, cy};
+  for (index_t dim = 0; dim < 2; ++dim) {
+    const real_t shift = (d[dim] == 0) ? 0.0 : (d[dim] == 1) ? 0.5 : 1.0;
+    c[dim][0] = cos(shift * M_PI / n[dim]);
+    c[dim][1] = cos((shift + 1.0) * M_PI / n[dim]);
+  }
+
+  // The constant mode in both directions is the null space of the pure
+  // Neumann problem and does not converge anyway
+  real_t mu = (wx * cx[0] + wy * cy[0]) / (wx + wy);
+  if (dx == 0 && dy == 0)
+    mu = max(wx * cx[1] + wy * cy[0], wx * cx[0] + wy * cy[1]) / (wx + wy);
+
+  return 2.0 / (1.0 + sqrt(1.0 - mu * mu));
+}
+
+index_t SOR::Smooth(Grid *grid, const Grid *rhs, const index_t &cycles) const {
+  const index_t *seg   = _geom->FluidSegments();
+  const index_t  n_seg = _geom->NFluidSegments();
+
+  real_t       *p = grid->Data();
+  const real_t *f = rhs->Data();
+
+  const real_t scale = _omega * _hsquare;
+
+  for (index_t c = 0; c < cycles; ++c) {
+    for (index_t s = 0; s < n_seg; ++s)
+      for (index_t k = seg[2 * s]; k < seg[2 * s + 1]; ++k)
+        p[k] = p[k] + scale * this->localRes(k, p, f);
+    _geom->Update_P(grid);
+  }
+
+  return cycles;
+}
+
+
+/***************************************************************************
+ *                              RED-BLACK SOR                              *
+ ***************************************************************************/
+
+RedBlackSOR::RedBlackSOR(const Geometry *geom, const real_t &omega) : SOR(geom, omega) {
+  const multi_index_t &size = _geom->Size();
+
+  // Bake the fluid mask so the sweeps don't have to look up the cell types
+  _mask    = new real_t[size[0] * size[1]];
+  _n_fluid = 0;
+
+  Iterator it(_geom);
+  for (it.First(); it.Valid(); it.Next())
+    _mask[it] = 0.0;
+
+  InteriorIterator init(_geom);
+  for (init.First(); init.Valid(); init.Next()) {
+    if (_geom->CellTypeAt(init) == CellType::Fluid) {
+      _mask[init] = 1.0;
+      _n_fluid   += 1;
+    }
+  }
+
+  // The residual is averaged over the fluid cells of all blocks
+  _n_fluid = _geom->Comm()->GatherSum(_n_fluid);
+}
+
+RedBlackSOR::~RedBlackSOR(){
+  delete[] _mask;
+}
+
+real_t RedBlackSOR::Cycle(Grid *grid, const Grid *rhs) const {
+  accum_t totalRes(0.0);
+
+  // Red cells first, then black cells. The black cells next to other blocks
+  // need the new red values of these blocks.
+  totalRes += this->HalfSweep(grid, rhs, 0);
+  _geom->Comm()->CopyBoundary(grid);
+  totalRes += this->HalfSweep(grid, rhs, 1);
+
+  return sqrt(_geom->Comm()->GatherSum(totalRes) / _n_fluid);
+}
+
+index_t RedBlackSOR::Smooth(Grid *grid, const Grid *rhs, const index_t &cycles) const {
+  for (index_t c = 0; c < cycles; ++c) {
+    this->Relax(grid, rhs, 0);
+    _geom->Comm()->CopyBoundary(grid);
+    this->Relax(grid, rhs, 1);
+    _geom->Update_P(grid);
+  }
+
+  return cycles;
+}
+
+SIMD_CLONES accum_t RedBlackSOR::HalfSweep(Grid *grid, const Grid *rhs, const index_t &colour) const {
+  const index_t nx = _geom->Size()[0];
+  const index_t ny = _geom->Size()[1];
+
+  real_t       *p    = grid->Data();
+  const real_t *f    = rhs->Data();
+  const real_t *mask = _mask;
+
+  const real_t scale = _omega * _hsquare;
+
+  // The colour is determined by the global cell index, so the colours of
+  // neighbouring blocks match
+  const index_t parity = colour + _geom->Offset()[0] + _geom->Offset()[1];
+
+  accum_t totalRes(0.0);
+
+  // Cells of one colour only depend on cells of the other colour
+  OMP_FOR_REDUCE(+, totalRes)
+  for (index_t j = 1; j < ny - 1; ++j) {
+    // First interior cell of the given colour in row j; cell (1,1) is red
+    const index_t first = j * nx + 1 + ((j + 1 + parity) & 1);
+    const index_t last  = j * nx + nx - 1;
+
+    SIMD_LOOP_REDUCE(+, totalRes)
+    for (index_t k = first; k < last; k += 2) {
+      const real_t localRes = this->localRes(k, p, f);
+
+      // Obstacles have a mask value of zero and are left untouched
+      p[k]     += mask[k] * scale * localRes;
+      totalRes += mask[k] * localRes * localRes;
+    }
+  }
+
+  return totalRes;
+}
+
+SIMD_CLONES void RedBlackSOR::Relax(Grid *grid, const Grid *rhs, const index_t &colour) const {
+  const index_t nx = _geom->Size()[0];
+  const index_t ny = _geom->Size()[1];
+
+  real_t       *p    = grid->Data();
+  const real_t *f    = rhs->Data();
+  const real_t *mask = _mask;
+
+  const real_t scale = _omega * _hsquare;
+
+  const index_t parity = colour + _geom->Offset()[0] + _geom->Offset()[1];
+
+  OMP_FOR
+  for (index_t j = 1; j < ny - 1; ++j) {
+    const index_t first = j * nx + 1 + ((j + 1 + parity) & 1);
+    const index_t last  = j * nx + nx - 1;
+
+    SIMD_LOOP
+    for (index_t k = first; k < last; k += 2)
+      p[k] += mask[k] * scale * this->localRes(k, p, f);
+  }
+}
+
+
+/***************************************************************************
+ *                              POISSON LEVEL                              *
+ ***************************************************************************/
+
+PoissonLevel::PoissonLevel(const Geometry *geom) {
+  const multi_index_t &size = geom->Size();
+
+  _nx     = size[0] - 2;
+  _ny     = size[1] - 2;
+  _stride = size[0];
+  _wx     = 1.0 / (geom->Mesh()[0] * geom->Mesh()[0]);
+  _wy     = 1.0 / (geom->Mesh()[1] * geom->Mesh()[1]);
+
+  this->Allocate();
+
+  InteriorIterator init(geom);
+  for (init.First(); init.Valid(); init.Next())
+    _fluid[init] = geom->CellTypeAt(init) == CellType::Fluid;
+
+  // Non-fluid neighbours on the domain boundary may fix the pressure, interior
+  // obstacles never do
+  for (init.First(); init.Valid(); init.Next()) {
+    if (!_fluid[init])
+      continue;
+
+    const multi_index_t pos = init.Pos();
+
+    if (pos[0] == 1 && geom->IsPDirichlet(init - 1))
+      _dirichlet[init] |= 1;
+    if (pos[0] == _nx && geom->IsPDirichlet(init + 1))
+      _dirichlet[init] |= 2;
+    if (pos[1] == 1 && geom->IsPDirichlet(init - _stride))
+      _dirichlet[init] |= 4;
+    if (pos[1] == _ny && geom->IsPDirichlet(init + _stride))
+      _dirichlet[init] |= 8;
+  }
+
+  this->Assemble();
+}
+
+PoissonLevel::PoissonLevel(const PoissonLevel *fine) {
+  _nx     = (fine->_nx + 1) / 2;
+  _ny     = (fine->_ny + 1) / 2;
+  _stride = _nx + 2;
+  _wx     = 0.25 * fine->_wx;
+  _wy     = 0.25 * fine->_wy;
+
+  this->Allocate();
+
+  for (index_t J = 1; J <= _ny; ++J) {
+    for (index_t I = 1; I <= _nx; ++I) {
+      const index_t K = J * _stride + I;
+
+      // Children of the coarse cell; the last row/column may only have one
+      const index_t i0 = 2 * I - 1;
+      const index_t j0 = 2 * J - 1;
+      const index_t i1 = min(2 * I, fine->_nx);
+      const index_t j1 = min(2 * J, fine->_ny);
+
+      for (index_t j = j0; j <= j1; ++j) {
+        for (index_t i = i0; i <= i1; ++i) {
+          const index_t k = j * fine->_stride + i;
+
+          if (!fine->_fluid[k])
+            continue;
+
+          _fluid[K] = 1;
+
+          // Only take over the Dirichlet neighbours on the matching side
+          if (i == i0) _dirichlet[K] |= fine->_dirichlet[k] & 1;
+          if (i == i1) _dirichlet[K] |= fine->_dirichlet[k] & 2;
+          if (j == j0) _dirichlet[K] |= fine->_dirichlet[k] & 4;
+          if (j == j1) _dirichlet[K] |= fine->_dirichlet[k] & 8;
+        }
+      }
+    }
+  }
+
+  this->Assemble();
+}
+
+PoissonLevel::~PoissonLevel() {
+  delete[] _fluid;
+  delete[] _dirichlet;
+  delete[] _cl;
+  delete[] _cr;
+  delete[] _cd;
+  delete[] _ct;
+  delete[] _diag;
+  delete[] _idiag;
+  delete[] _x;
+  delete[] _b;
+  delete[] _r;
+  delete[] _ic;
+}
+
+const index_t &PoissonLevel::Nx() const {
+  return _nx;
+}
+
+const index_t &PoissonLevel::Ny() const {
+  return _ny;
+}
+
+const index_t &PoissonLevel::NFluid() const {
+  return _n_fluid;
+}
+
+bool PoissonLevel::Singular() const {
+  return _singular;
+}
+
+real_t *PoissonLevel::X() {
+  return _x;
+}
+
+real_t *PoissonLevel::B() {
+  return _b;
+}
+
+real_t *PoissonLevel::R() {
+  return _r;
+}
+
+void PoissonLevel::Apply(const real_t *x, real_t *y) const {
+  OMP_FOR
+  for (index_t j = 1; j <= _ny; ++j) {
+    for (index_t k = j * _stride + 1; k <= j * _stride + _nx; ++k) {
+      y[k] = _cl[k] * x[k - 1] + _cr[k] * x[k + 1]
+        + _cd[k] * x[k - _stride] + _ct[k] * x[k + _stride]
+        + _diag[k] * x[k];
+    }
+  }
+}
+
+void PoissonLevel::Smooth(real_t *x, const real_t *b, const index_t &sweeps) const {
+  for (index_t s = 0; s < sweeps; ++s) {
+    for (index_t colour = 0; colour < 2; ++colour) {
+      // Cells of one colour only depend on cells of the other colour
+      OMP_FOR
+      for (index_t j = 1; j <= _ny; ++j) {
+        const index_t first = j * _stride + 1 + ((j + 1 + colour) & 1);
+        const index_t last  = j * _stride + _nx;
+
+        for (index_t k = first; k <= last; k += 2) {
+          const real_t ax = _cl[k] * x[k - 1] + _cr[k] * x[k + 1]
+            + _cd[k] * x[k - _stride] + _ct[k] * x[k + _stride]
+            + _diag[k] * x[k];
+
+          // Non-fluid cells have an inverse diagonal of zero
+          x[k] += _idiag[k] * (b[k] - ax);
+        }
+      }
+    }
+  }
+}
+
+accum_t PoissonLevel::Residual(const real_t *x, const real_t *b, real_t *r) const {
+  accum_t totalRes(0.0);
+
+  this->Apply(x, r);
+
+  OMP_FOR_REDUCE(+, totalRes)
+  for (index_t j = 1; j <= _ny; ++j) {
+    for (index_t k = j * _stride + 1; k <= j * _stride + _nx; ++k) {
+      r[k]      = _fluid[k] ? b[k] - r[k] : 0.0;
+      totalRes += r[k] * r[k];
+    }
+  }
+
+  return totalRes;
+}
+
+void PoissonLevel::Restrict(const PoissonLevel *fine) {
+  OMP_FOR
+  for (index_t J = 1; J <= _ny; ++J) {
+    for (index_t I = 1; I <= _nx; ++I) {
+      const index_t K = J * _stride + I;
+
+      const index_t i1 = min(2 * I, fine->_nx);
+      const index_t j1 = min(2 * J, fine->_ny);
+
+      real_t sum(0.0);
+      for (index_t j = 2 * J - 1; j <= j1; ++j)
+        for (index_t i = 2 * I - 1; i <= i1; ++i)
+          sum += fine->_r[j * fine->_stride + i];
+
+      _b[K] = _fluid[K] ? 0.25 * sum : 0.0;
+    }
+  }
+}
+
+void PoissonLevel::Prolongate(PoissonLevel *fine) const {
+  OMP_FOR
+  for (index_t j = 1; j <= fine->_ny; ++j) {
+    for (index_t i = 1; i <= fine->_nx; ++i) {
+      const index_t k = j * fine->_stride + i;
+
+      if (!fine->_fluid[k])
+        continue;
+
+      const index_t K = ((j + 1) / 2) * _stride + (i + 1) / 2;
+
+      // The nearest coarse neighbours lie on the side of the child within its
+      // parent cell
+      const int  ox = (i & 1) ? -1 : 1;
+      const int  oy = (j & 1) ? -(int)_stride : (int)_stride;
+      const char bx = (i & 1) ? 1 : 2;
+      const char by = (j & 1) ? 4 : 8;
+
+      const real_t vc = _x[K];
+      const real_t vx = this->Neighbour(_x, K, ox, bx);
+      const real_t vy = this->Neighbour(_x, K, oy, by);
+
+      // Extrapolate the diagonal neighbour if it is not a fluid cell
+      const real_t vxy = _fluid[K + ox] && _fluid[K + oy] && _fluid[K + ox + oy]
+        ? _x[K + ox + oy] : vx + vy - vc;
+
+      fine->_x[k] += 0.5625 * vc + 0.1875 * (vx + vy) + 0.0625 * vxy;
+    }
+  }
+}
+
+void PoissonLevel::RemoveMean(real_t *x) const {
+  accum_t mean(0.0);
+
+  OMP_FOR_REDUCE(+, mean)
+  for (index_t j = 1; j <= _ny; ++j)
+    for (index_t k = j * _stride + 1; k <= j * _stride + _nx; ++k)
+      if (_fluid[k])
+        mean += x[k];
+
+  mean /= _n_fluid;
+
+  OMP_FOR
+  for (index_t j = 1; j <= _ny; ++j)
+    for (index_t k = j * _stride + 1; k <= j * _stride + _nx; ++k)
+      if (_fluid[k])
+        x[k] -= mean;
+}
+
+accum_t PoissonLevel::Dot(const real_t *a, const real_t *b) const {
+  accum_t sum(0.0);
+
+  OMP_FOR_REDUCE(+, sum)
+  for (index_t j = 1; j <= _ny; ++j)
+    for (index_t k = j * _stride + 1; k <= j * _stride + _nx; ++k)
+      sum += a[k] * b[k];
+
+  return sum;
+}
+
+void PoissonLevel::Jacobi(const real_t *r, real_t *z) const {
+  OMP_FOR
+  for (index_t j = 1; j <= _ny; ++j)
+    for (index_t k = j * _stride + 1; k <= j * _stride + _nx; ++k)
+      z[k] = _idiag[k] * r[k];
+}
+
+void PoissonLevel::SSOR(const real_t *r, real_t *z, const real_t &omega) const {
+  const real_t scale = omega * (2.0 - omega);
+
+  // Forward sweep: (D + omega L) w = omega (2 - omega) r
+  for (index_t j = 1; j <= _ny; ++j) {
+    for (index_t k = j * _stride + 1; k <= j * _stride + _nx; ++k) {
+      z[k] = _idiag[k] * (scale * r[k]
+        - omega * (_cl[k] * z[k - 1] + _cd[k] * z[k - _stride]));
+    }
+  }
+
+  // Backward sweep: (D + omega U) z = D w
+  for (index_t j = _ny; j >= 1; --j) {
+    for (index_t k = j * _stride + _nx; k >= j * _stride + 1; --k) {
+      z[k] -= omega * _idiag[k] * (_cr[k] * z[k + 1] + _ct[k] * z[k + _stride]);
+    }
+  }
+}
+
+void PoissonLevel::FactorIC() {
+  const index_t n = _stride * (_ny + 2);
+
+  if (!_ic)
+    _ic = new real_t[n];
+
+  for (index_t k = 0; k < n; ++k)
+    _ic[k] = 0.0;
+
+  // Pivots of the negated (positive) operator; the off-diagonal entries keep
+  // their sparsity pattern
+  for (index_t j = 1; j <= _ny; ++j) {
+    for (index_t k = j * _stride + 1; k <= j * _stride + _nx; ++k) {
+      if (!_fluid[k])
+        continue;
+
+      real_t pivot = -_diag[k];
+      if (_fluid[k - 1])
+        pivot -= _cl[k] * _cl[k] / _ic[k - 1];
+      if (_fluid[k - _stride])
+        pivot -= _cd[k] * _cd[k] / _ic[k - _stride];
+
+      // The last pivot of a singular operator vanishes; fall back to the
+      // diagonal entry there
+      _ic[k] = pivot > 1e-12 * -_diag[k] ? pivot : -_diag[k];
+    }
+  }
+}
+
+void PoissonLevel::SolveIC(const real_t *r, real_t *z) const {
+  // Forward substitution with the negated residual, since the factorization
+  // belongs to the negated operator
+  for (index_t j = 1; j <= _ny; ++j) {
+    for (index_t k = j * _stride + 1; k <= j * _stride + _nx; ++k) {
+      z[k] = _fluid[k]
+        ? (-r[k] + _cl[k] * z[k - 1] + _cd[k] * z[k - _stride]) / _ic[k]
+        : 0.0;
+    }
+  }
+
+  // Backward substitution
+  for (index_t j = _ny; j >= 1; --j) {
+    for (index_t k = j * _stride + _nx; k >= j * _stride + 1; --k) {
+      if (_fluid[k])
+        z[k] += (_cr[k] * z[k + 1] + _ct[k] * z[k + _stride]) / _ic[k];
+    }
+  }
+}
+
+void PoissonLevel::Allocate() {
+  const index_t n = _stride * (_ny + 2);
+
+  _fluid     = new char[n];
+  _dirichlet = new char[n];
+  _cl        = new real_t[n];
+  _cr        = new real_t[n];
+  _cd        = new real_t[n];
+  _ct        = new real_t[n];
+  _diag      = new real_t[n];
+  _idiag     = new real_t[n];
+  _x         = new real_t[n];
+  _b         = new real_t[n];
+  _r         = new real_t[n];
+
+  _ic        = NULL;
+
+  memset(_fluid, 0, n * sizeof(char));
+  memset(_dirichlet, 0, n * sizeof(char));
+
+  for (index_t k = 0; k < n; ++k) {
+    _cl[k] = _cr[k] = _cd[k] = _ct[k] = 0.0;
+    _diag[k] = _idiag[k] = 0.0;
+    _x[k] = _b[k] = _r[k] = 0.0;
+  }
+}
+
+void PoissonLevel::Assemble() {
+  _n_fluid = 0;
+
+  for (index_t j = 1; j <= _ny; ++j) {
+    for (index_t k = j * _stride + 1; k <= j * _stride + _nx; ++k) {
+      if (!_fluid[k])
+        continue;
+
+      _n_fluid += 1;
+
+      // Fluid neighbours are coupled, all others are mirrored into the
+      // diagonal entry. Dirichlet bits of fluid neighbours are meaningless.
+      _diag[k] = -2.0 * (_wx + _wy);
+
+      if (_fluid[k - 1]) {
+        _cl[k] = _wx;
+        _dirichlet[k] &= ~1;
+      } else {
+        _diag[k] += (_dirichlet[k] & 1) ? -_wx : _wx;
+      }
+
+      if (_fluid[k + 1]) {
+        _cr[k] = _wx;
+        _dirichlet[k] &= ~2;
+      } else {
+        _diag[k] += (_dirichlet[k] & 2) ? -_wx : _wx;
+      }
+
+      if (_fluid[k - _stride]) {
+        _cd[k] = _wy;
+        _dirichlet[k] &= ~4;
+      } else {
+        _diag[k] += (_dirichlet[k] & 4) ? -_wy : _wy;
+      }
+
+      if (_fluid[k + _stride]) {
+        _ct[k] = _wy;
+        _dirichlet[k] &= ~8;
+      } else {
+        _diag[k] += (_dirichlet[k] & 8) ? -_wy : _wy;
+      }
+
+      // An isolated cell surrounded by Neumann neighbours stays untouched
+      _idiag[k] = _diag[k] != 0.0 ? 1.0 / _diag[k] : 0.0;
+    }
+  }
+
+  // Without any Dirichlet neighbour the operator is only determined up to a
+  // constant
+  _singular = true;
+  for (index_t j = 1; j <= _ny; ++j)
+    for (index_t k = j * _stride + 1; k <= j * _stride + _nx; ++k)
+      if (_dirichlet[k])
+        _singular = false;
+}
+
+real_t PoissonLevel::Neighbour(const real_t *x, const index_t &k, const int &offset, const char &bit) const {
+  if (_fluid[k + offset])
+    return x[k + offset];
+
+  return (_dirichlet[k] & bit) ? -x[k] : x[k];
+}
+
+
+/***************************************************************************
+ *                                MULTIGRID                                *
+ ***************************************************************************/
+
+Multigrid::Multigrid(const Geometry *geom, const index_t &gamma) : Solver(geom), _gamma(gamma) {
+  // Count the levels; coarsen as long as both directions have more than two
+  // cells
+  index_t nx = _geom->Size()[0] - 2;
+  index_t ny = _geom->Size()[1] - 2;
+
+  _n_levels = 1;
+  while (nx > 2 && ny > 2) {
+    nx = (nx + 1) / 2;
+    ny = (ny + 1) / 2;
+    _n_levels++;
+  }
+
+  // Build the hierarchy
+  _levels    = new PoissonLevel*[_n_levels];
+  _levels[0] = new PoissonLevel(_geom);
+  for (index_t l = 1; l < _n_levels; ++l)
+    _levels[l] = new PoissonLevel(_levels[l - 1]);
+
+  printf("Multigrid %c-cycle with %d levels, coarsest level %d x %d\n",
+    _gamma == 1 ? 'V' : 'W',
+    _n_levels,
+    _levels[_n_levels - 1]->Nx(),
+    _levels[_n_levels - 1]->Ny()
+  );
+}
+
+Multigrid::~Multigrid(){
+  for (index_t l = 0; l < _n_levels; ++l)
+    delete _levels[l];
+  delete[] _levels;
+}
+
+real_t Multigrid::Cycle(Grid *grid, const Grid *rhs) const {
+  PoissonLevel *fine = _levels[0];
+
+  real_t *x = fine->X();
+  real_t *b = fine->B();
+
+  // The finest level shares the layout of the grid. Its right-hand side is the
+  // defect of the current pressure, its unknown the correction.
+  const index_t nx = _geom->Size()[0];
+  const index_t ny = _geom->Size()[1];
+  const char *cells = _geom->GetCells();
+
+  for (index_t j = 1; j < ny - 1; ++j) {
+    for (index_t k = j * nx + 1; k < j * nx + nx - 1; ++k) {
+      x[k] = 0.0;
+      b[k] = cells[k] == CellType::Fluid
+        ? -this->localRes(k, grid->Data(), rhs->Data()) : 0.0;
+    }
+  }
+
+  this->LevelCycle(0);
+
+  // Apply the correction
+  real_t *p = grid->Data();
+  for (index_t j = 1; j < ny - 1; ++j) {
+    for (index_t k = j * nx + 1; k < j * nx + nx - 1; ++k) {
+      if (cells[k] == CellType::Fluid)
+        p[k] += x[k];
+    }
+  }
+
+  return sqrt(fine->Residual(x, b, fine->R()) / fine->NFluid());
+}
+
+void Multigrid::LevelCycle(const index_t &l) const {
+  PoissonLevel *level = _levels[l];
+
+  // Solve on the coarsest level by smoothing until the defect is gone
+  if (l == _n_levels - 1) {
+    if (level->Singular())
+      level->RemoveMean(level->B());
+
+    const index_t n = max(level->Nx(), level->Ny());
+    level->Smooth(level->X(), level->B(), min(index_t(MG_COARSE_SWEEPS), max(index_t(20), n * n)));
+    return;
+  }
+
+  PoissonLevel *coarse = _levels[l + 1];
+
+  level->Smooth(level->X(), level->B(), MG_PRE_SWEEPS);
+  level->Residual(level->X(), level->B(), level->R());
+
+  coarse->Restrict(level);
+
+  // Start the coarse correction from zero
+  const index_t n = (coarse->Nx() + 2) * (coarse->Ny() + 2);
+  real_t *xc = coarse->X();
+  for (index_t k = 0; k < n; ++k)
+    xc[k] = 0.0;
+
+  for (index_t g = 0; g < _gamma; ++g)
+    this->LevelCycle(l + 1);
+
+  coarse->Prolongate(level);
+
+  level->Smooth(level->X(), level->B(), MG_POST_SWEEPS);
+}
+
+
+/***************************************************************************
+ *                                   PCG                                   *
+ ***************************************************************************/
+
+PCG::PCG(const Geometry *geom, const index_t &precond, const real_t &omega,
+         const real_t &eps, const index_t &itermax)
+    : Solver(geom), _precond(precond), _omega(omega), _eps(eps), _itermax(itermax) {
+  _level = new PoissonLevel(_geom);
+
+  const index_t n = _geom->Size()[0] * _geom->Size()[1];
+
+  _z       = new real_t[n];
+  _d       = new real_t[n];
+  _q       = new real_t[n];
+  _history = new real_t[_itermax + 1];
+
+  for (index_t k = 0; k < n; ++k)
+    _z[k] = _d[k] = _q[k] = 0.0;
+
+  _iterations = 0;
+  _history[0] = 0.0;
+
+  switch (_precond) {
+    case PreconditionerType::Precond_Jacobi:
+      printf("PCG with Jacobi preconditioner\n");
+      break;
+
+    case PreconditionerType::Precond_SSOR:
+      printf("PCG with SSOR preconditioner, omega: %f\n", _omega);
+      break;
+
+    case PreconditionerType::Precond_IC:
+      printf("PCG with incomplete Cholesky preconditioner\n");
+      _level->FactorIC();
+      break;
+
+    default:
+      throw std::runtime_error(std::string("Unknown preconditioner type: " + std::to_string(_precond)));
+      break;
+  }
+}
+
+PCG::~PCG(){
+  delete _level;
+  delete[] _z;
+  delete[] _d;
+  delete[] _q;
+  delete[] _history;
+}
+
+real_t PCG::Cycle(Grid *grid, const Grid *rhs) const {
+  real_t *x = _level->X();
+  real_t *r = _level->R();
+
+  const real_t n = _level->NFluid();
+
+  // The level shares the layout of the grid. The right-hand side of the
+  // correction equation is the defect of the current pressure.
+  const index_t nx = _geom->Size()[0];
+  const index_t ny = _geom->Size()[1];
+  const char *cells = _geom->GetCells();
+
+  for (index_t j = 1; j < ny - 1; ++j) {
+    for (index_t k = j * nx + 1; k < j * nx + nx - 1; ++k) {
+      x[k] = 0.0;
+      r[k] = cells[k] == CellType::Fluid
+        ? -this->localRes(k, grid->Data(), rhs->Data()) : 0.0;
+    }
+  }
+
+  // Pure Neumann problems are only solvable for a defect with zero mean
+  const bool singular = _level->Singular();
+  if (singular)
+    _level->RemoveMean(r);
+
+  accum_t res = _level->Dot(r, r);
+  _iterations = 0;
+  _history[0] = sqrt(res / n);
+
+  this->Precondition(r, _z);
+  accum_t rz = _level->Dot(r, _z);
+
+  const index_t size = _geom->Size()[0] * _geom->Size()[1];
+  for (index_t k = 0; k < size; ++k)
+    _d[k] = _z[k];
+
+  while (_iterations < _itermax && _history[_iterations] >= _eps) {
+    _level->Apply(_d, _q);
+
+    const real_t alpha = rz / _level->Dot(_d, _q);
+
+    for (index_t j = 1; j < ny - 1; ++j) {
+      for (index_t k = j * nx + 1; k < j * nx + nx - 1; ++k) {
+        x[k] += alpha * _d[k];
+        r[k] -= alpha * _q[k];
+      }
+    }
+
+    res = _level->Dot(r, r);
+    _iterations++;
+    _history[_iterations] = sqrt(res / n);
+
+    this->Precondition(r, _z);
+    const accum_t rz_new = _level->Dot(r, _z);
+    const real_t beta   = rz_new / rz;
+    rz = rz_new;
+
+    for (index_t j = 1; j < ny - 1; ++j)
+      for (index_t k = j * nx + 1; k < j * nx + nx - 1; ++k)
+        _d[k] = _z[k] + beta * _d[k];
+  }
+
+  if (singular)
+    _level->RemoveMean(x);
+
+  // Apply the correction
+  real_t *p = grid->Data();
+  for (index_t j = 1; j < ny - 1; ++j) {
+    for (index_t k = j * nx + 1; k < j * nx + nx - 1; ++k) {
+      if (cells[k] == CellType::Fluid)
+        p[k] += x[k];
+    }
+  }
+
+  // The averaged corner values of obstacles are not part of the operator, so
+  // the converged inner residual may hide a defect. Report the true one.
+  return this->totalRes(grid, rhs);
+}
+
+void PCG::Report() const {
+  printf("  PCG iterations: %d\n", _iterations);
+  printf("  PCG residual history:");
+
+  // Print at most PCG_REPORT_ENTRIES evenly spread entries and the last one
+  const index_t step = _iterations / PCG_REPORT_ENTRIES + 1;
+  for (index_t i = 0; i < _iterations; i += step)
+    printf(" [%d] %.3e", i, _history[i]);
+  printf(" [%d] %.3e\n", _iterations, _history[_iterations]);
+}
+
+const index_t &PCG::Iterations() const {
+  return _iterations;
+}
+
+const real_t *PCG::History() const {
+  return _history;
+}
+
+void PCG::Precondition(const real_t *r, real_t *z) const {
+  switch (_precond) {
+    case PreconditionerType::Precond_Jacobi:
+      _level->Jacobi(r, z);
+      break;
+
+    case PreconditionerType::Precond_SSOR:
+      _level->SSOR(r, z, _omega);
+      break;
+
+    case PreconditionerType::Precond_IC:
+      _level->SolveIC(r, z);
+      break;
+  }
+
+  if (_level->Singular())
+    _level->RemoveMean(z);
+}
+
+
+/***************************************************************************
+ *                              TRIGTRANSFORM                              *
+ ***************************************************************************/
+
+TrigTransform::TrigTransform(const index_t &n, const bool &left, const bool &right,
+                             const real_t &weight) : _n(n) {
+  // The basis vectors are cos or sin(pi (k + shift) (i + 1/2) / n). A
+  // Dirichlet wall on the left needs the sine, a single Dirichlet wall shifts
+  // the wave numbers by a half and two by one.
+  _sine = left;
+  const real_t shift = (left && right) ? 1.0 : ((left || right) ? 0.5 : 0.0);
+
+  const index_t length = 2 * _n;
+
+  _m = 1;
+  while (_m < length)
+    _m *= 2;
+
+  // Bluestein's algorithm needs room for a linear convolution
+  if (_m != length) {
+    while (_m < 2 * length - 1)
+      _m *= 2;
+  }
+
+  _pre    = new complex_t[_n];
+  _post   = new complex_t[_n];
+  _ipre   = new complex_t[_n];
+  _ipost  = new complex_t[_n];
+  _roots  = new complex_t[_m / 2];
+  _work   = new complex_t[_m];
+  _norm   = new real_t[_n];
+  _lambda = new real_t[_n];
+
+  for (index_t k = 0; k < _n; ++k) {
+    _pre[k]   = polar(real_t(1.0), real_t(-M_PI * shift * k / _n));
+    _post[k]  = polar(real_t(1.0), real_t(-M_PI * (k + shift) / (2.0 * _n)));
+    _ipre[k]  = polar(real_t(1.0), real_t(-M_PI * k / (2.0 * _n)));
+    _ipost[k] = polar(real_t(1.0), real_t(-M_PI * shift * (k + 0.5) / _n));
+
+    // All basis vectors have the squared norm n/2 except the constant and
+    // the alternating one, which have n
+    const real_t wave = k + shift;
+    _norm[k] = (wave == 0.0 || wave == _n) ? 1.0 / _n : 2.0 / _n;
+
+    const real_t s = sin(M_PI * wave / (2.0 * _n));
+    _lambda[k] = -4.0 * weight * s * s;
+  }
+
+  for (index_t k = 0; k < _m / 2; ++k)
+    _roots[k] = polar(real_t(1.0), real_t(-2.0 * M_PI * k / _m));
+
+  _chirp     = NULL;
+  _chirp_hat = NULL;
+
+  if (_m != length) {
+    _chirp     = new complex_t[length];
+    _chirp_hat = new complex_t[_m];
+
+    // Reduce k^2 modulo 2 * length to keep the argument small
+    for (index_t k = 0; k < length; ++k) {
+      const index_t kk = (index_t)(((unsigned long long)k * k) % (2 * length));
+      _chirp[k] = polar(real_t(1.0), real_t(M_PI * kk / length));
+    }
+
+    for (index_t k = 0; k < _m; ++k)
+      _chirp_hat[k] = 0.0;
+
+    _chirp_hat[0] = _chirp[0];
+    for (index_t k = 1; k < length; ++k)
+      _chirp_hat[k] = _chirp_hat[_m - k] = _chirp[k];
+
+    this->FFT(_chirp_hat, false);
+  }
+}
+
+TrigTransform::~TrigTransform() {
+  delete[] _pre;
+  delete[] _post;
+  delete[] _ipre;
+  delete[] _ipost;
+  delete[] _roots;
+  delete[] _work;
+  delete[] _norm;
+  delete[] _lambda;
+
+  if (_chirp != NULL) {
+    delete[] _chirp;
+    delete[] _chirp_hat;
+  }
+}
+
+void TrigTransform::Forward(const real_t *in, real_t *out) const {
+  for (index_t i = 0; i < _n; ++i)
+    _work[i] = in[i] * _pre[i];
+  for (index_t i = _n; i < _m; ++i)
+    _work[i] = 0.0;
+
+  this->DFT(_work);
+
+  for (index_t k = 0; k < _n; ++k) {
+    const complex_t z = _work[k] * _post[k];
+    out[k] = _sine ? -z.imag() : z.real();
+  }
+}
+
+void TrigTransform::Backward(const real_t *in, real_t *out) const {
+  for (index_t k = 0; k < _n; ++k)
+    _work[k] = in[k] * _norm[k] * _ipre[k];
+  for (index_t k = _n; k < _m; ++k)
+    _work[k] = 0.0;
+
+  this->DFT(_work);
+
+  for (index_t i = 0; i < _n; ++i) {
+    const complex_t z = _work[i] * _ipost[i];
+    out[i] = _sine ? -z.imag() : z.real();
+  }
+}
+
+const real_t *TrigTransform::Eigenvalues() const {
+  return _lambda;
+}
+
+void TrigTransform::DFT(complex_t *a) const {
+  if (_chirp == NULL) {
+    this->FFT(a, false);
+    return;
+  }
+
+  // Bluestein: write the DFT as a convolution with the chirp
+  const index_t length = 2 * _n;
+
+  for (index_t k = 0; k < length; ++k)
+    a[k] *= conj(_chirp[k]);
+  for (index_t k = length; k < _m; ++k)
+    a[k] = 0.0;
+
+  this->FFT(a, false);
+  for (index_t k = 0; k < _m; ++k)
+    a[k] *= _chirp_hat[k];
+  this->FFT(a, true);
+
+  const real_t scale = 1.0 / _m;
+  for (index_t k = 0; k < length; ++k)
+    a[k] *= conj(_chirp[k]) * scale;
+}
+
+void TrigTransform::FFT(complex_t *a, const bool &inverse) const {
+  // Bit reversal permutation
+  for (index_t i = 1, j = 0; i < _m; ++i) {
+    index_t bit = _m >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+
+    if (i < j)
+      swap(a[i], a[j]);
+  }
+
+  for (index_t len = 2; len <= _m; len *= 2) {
+    const index_t half = len / 2;
+    const index_t step = _m / len;
+
+    for (index_t i = 0; i < _m; i += len) {
+      for (index_t j = 0; j < half; ++j) {
+        const complex_t w = inverse ? conj(_roots[j * step]) : _roots[j * step];
+        const complex_t t = a[i + j + half] * w;
+
+        a[i + j + half] = a[i + j] - t;
+        a[i + j]       += t;
+      }
+    }
+  }
+}
+
+
+/***************************************************************************
+ *                                FFTSOLVER                                *
+ ***************************************************************************/
+
+FFTSolver::FFTSolver(const Geometry *geom) : Solver(geom) {
+  if (!FFTSolver::Applicable(_geom))
+    throw std::runtime_error(std::string("The FFT solver needs a rectangular domain without obstacles"));
+
+  _nx = _geom->Size()[0] - 2;
+  _ny = _geom->Size()[1] - 2;
+
+  const real_t wx = _sh_ism0;
+  const real_t wy = _sh_ism1;
+
+  const bool left   = _geom->PBoundaryType(4) == 1;
+  const bool right  = _geom->PBoundaryType(2) == 1;
+  const bool bottom = _geom->PBoundaryType(1) == 1;
+  const bool top    = _geom->PBoundaryType(3) == 1;
+
+  _singular = !(left || right || bottom || top);
+
+  _transform = new TrigTransform(_nx, left, right, wx);
+
+  _cp     = new real_t[_nx * _ny];
+  _ipivot = new real_t[_nx * _ny];
+  _b      = new real_t[_nx * _ny];
+  _bh     = new real_t[_nx * _ny];
+
+  // Factorize the tridiagonal system of every wave number once. The walls in
+  // y direction are mirrored into the first and last diagonal entries.
+  const real_t *lambda = _transform->Eigenvalues();
+
+  for (index_t k = 0; k < _nx; ++k) {
+    real_t *cp     = &_cp[k * _ny];
+    real_t *ipivot = &_ipivot[k * _ny];
+
+    for (index_t j = 0; j < _ny; ++j) {
+      real_t diag = lambda[k] - 2.0 * wy;
+      if (j == 0)
+        diag += bottom ? -wy : wy;
+      if (j == _ny - 1)
+        diag += top ? -wy : wy;
+
+      const real_t pivot = j == 0 ? diag : diag - wy * cp[j - 1];
+
+      ipivot[j] = 1.0 / pivot;
+      cp[j]     = wy * ipivot[j];
+    }
+  }
+
+  // The constant mode has a vanishing last pivot. Pinning its last value to
+  // zero picks one solution, the mean is removed afterwards.
+  if (_singular)
+    _ipivot[_ny - 1] = 0.0;
+
+  printf("FFT solver, pressure boundaries (left right bottom top): %c %c %c %c\n",
+    left ? 'D' : 'N', right ? 'D' : 'N', bottom ? 'D' : 'N', top ? 'D' : 'N');
+}
+
+FFTSolver::~FFTSolver() {
+  delete _transform;
+  delete[] _cp;
+  delete[] _ipivot;
+  delete[] _b;
+  delete[] _bh;
+}
+
+real_t FFTSolver::Cycle(Grid *grid, const Grid *rhs) const {
+  // The interior cells are packed row by row into the compact layout. The
+  // right-hand side of the correction equation is the defect.
+  real_t       *p = grid->Data();
+  const real_t *f = rhs->Data();
+  index_t c(0);
+
+  for (index_t j = 1; j <= _ny; ++j)
+    for (index_t k = j * _stride + 1; k <= j * _stride + _nx; ++k)
+      _b[c++] = -this->localRes(k, p, f);
+
+  // Pure Neumann problems are only solvable for a defect with zero mean
+  if (_singular)
+    this->RemoveMean(_b);
+
+  for (index_t j = 0; j < _ny; ++j)
+    _transform->Forward(&_b[j * _nx], &_bh[j * _nx]);
+
+  // Solve the tridiagonal system of each wave number in place
+  const real_t wy = _sh_ism1;
+
+  OMP_FOR
+  for (index_t k = 0; k < _nx; ++k) {
+    const real_t *cp     = &_cp[k * _ny];
+    const real_t *ipivot = &_ipivot[k * _ny];
+
+    _bh[k] *= ipivot[0];
+    for (index_t j = 1; j < _ny; ++j)
+      _bh[j * _nx + k] = (_bh[j * _nx + k] - wy * _bh[(j - 1) * _nx + k]) * ipivot[j];
+
+    for (index_t j = _ny - 1; j > 0; --j)
+      _bh[(j - 1) * _nx + k] -= cp[j - 1] * _bh[j * _nx + k];
+  }
+
+  for (index_t j = 0; j < _ny; ++j)
+    _transform->Backward(&_bh[j * _nx], &_b[j * _nx]);
+
+  if (_singular)
+    this->RemoveMean(_b);
+
+  // Apply the correction
+  c = 0;
+  for (index_t j = 1; j <= _ny; ++j)
+    for (index_t k = j * _stride + 1; k <= j * _stride + _nx; ++k)
+      p[k] += _b[c++];
+
+  return this->totalRes(grid, rhs);
+}
+
+bool FFTSolver::Applicable(const Geometry *geom) {
+  if (!geom->ObstacleFree())
+    return false;
+
+  for (index_t boundary = 1; boundary <= 4; ++boundary)
+    if (geom->PBoundaryType(boundary) < 0)
+      return false;
+
+  return true;
+}
+
+void FFTSolver::RemoveMean(real_t *x) const {
+  const index_t n = _nx * _ny;
+  accum_t mean(0.0);
+
+  for (index_t k = 0; k < n; ++k)
+    mean += x[k];
+
+  mean /= n;
+
+  for (index_t k = 0; k < n; ++k)
+    x[k] -= mean;
 }
\ No newline at end of file
@@ -16,6 +16,7 @@
  */
 //------------------------------------------------------------------------------
 #include "typedef.hpp"
+#include <complex>
 //------------------------------------------------------------------------------
 #ifndef __SOLVER_HPP
 #define __SOLVER_HPP
@@ -43,6 +44,40 @@ public:
   /// @return real_t The accumulated residual
   virtual real_t Cycle(Grid *grid, const Grid *rhs) const = 0;
 
+  /// Performs up to the given number of cycles without computing the
+  /// residual and updates the boundary values of the pressure after each of
+  /// them. Solvers which need the residual in every cycle perform none; this
+  /// is the default.
+  ///
+  /// @param [in][out] grid Grid The current p values. This grid will be modified with the
+  ///   new values.
+  /// @param rhs Grid The RHS values used in the calculation
+  /// @param cycles index_t The maximum number of cycles
+  /// @return index_t The number of cycles performed
+  virtual index_t Smooth(Grid *grid, const Grid *rhs, const index_t &cycles) const;
+
+  /// Prints solver specific statistics of the last cycle. Does nothing unless
+  /// implemented in a child class.
+  virtual void Report() const;
+
+  /// Adapts the solver to the observed convergence of the last solve. Does
+  /// nothing unless implemented in a child class.
+  ///
+  /// @param rate real_t The mean contraction of the residual per cycle at
+  ///   the end of the last solve
+  virtual void Adapt(const real_t &rate);
+
+  /// Writes the state the solver adapted during the run to a checkpoint.
+  /// Does nothing unless implemented in a child class.
+  ///
+  /// @param handle FILE* The opened checkpoint file
+  virtual void WriteCheckpoint(FILE *handle) const;
+
+  /// Restores the state written by WriteCheckpoint.
+  ///
+  /// @param handle FILE* The opened checkpoint file
+  virtual void ReadCheckpoint(FILE *handle);
+
 protected:
   /// _geom Geometry The geometry for boundary values etc.
   const Geometry *_geom;
@@ -61,14 +96,41 @@ protected:
   ///   in y direction.
   real_t _sh_ism1;
 
+  /// _stride index_t The distance of vertically neighbouring cells
+  index_t _stride;
+
   /// Returns the residual at [it] for the pressure-Poisson equation.
   ///
   /// @param it Iterator The position
   /// @param grid Grid The grid containing the p values
   /// @param rhs Grid The grid containging the RHS values
   real_t localRes(const Iterator &it, const Grid *grid, const Grid *rhs) const;
+
+  /// Returns the residual at the interior cell k for the pressure-Poisson
+  /// equation. The neighbours are found by constant offsets, which is cheaper
+  /// than the iterator variant in the loops over all cells.
+  ///
+  /// @param k index_t The index of an interior cell
+  /// @param p real_t* The p values
+  /// @param f real_t* The RHS values
+  real_t localRes(const index_t &k, const real_t *p, const real_t *f) const;
+
+  /// Updates the boundary values of the pressure and returns the root mean
+  /// square of the residual over all fluid cells.
+  ///
+  /// @param grid Grid The grid containing the p values
+  /// @param rhs Grid The grid containging the RHS values
+  /// @return real_t The residual
+  real_t totalRes(Grid *grid, const Grid *rhs) const;
 };
 
+inline real_t Solver::localRes(const index_t &k, const real_t *p, const real_t *f) const {
+  return (p[k - 1] + p[k + 1]) * _sh_ism0
+    + (p[k - _stride] + p[k + _stride]) * _sh_ism1
+    - p[k] * _ihsquare
+    - f[k];
+}
+
 //------------------------------------------------------------------------------
 
 /// The SOR solver, implementing Solver functionality by using the SOR algo-
@@ -76,9 +138,14 @@ protected:
 class SOR : public Solver {
 public:
   /// Constructs an SOR solver using the given geometry and omega parameter.
+  /// If omega is not positive, the optimal omega is computed from the
+  /// geometry. Unless this optimum is exact, omega is adapted after each
+  /// solve.
   ///
+  /// @see OptimalOmega
   /// @param geom Geometry The geometry
-  /// @param omega real_t The omega parameter used in the calculation
+  /// @param omega real_t The omega parameter used in the calculation, 0 to
+  ///   choose it automatically
   SOR(const Geometry *geom, const real_t &omega);
 
   /// Deconstructs the SOR instance.
@@ -93,9 +160,631 @@ public:
   /// @return real_t The accumulated residual
   real_t Cycle(Grid *grid, const Grid *rhs) const;
 
+  /// Performs the given number of cycles without computing the residual and
+  /// updates the boundary values after each of them.
+  ///
+  /// @param grid Grid The current p values. This grid will be modified with the
+  ///   new values.
+  /// @param rhs Grid The RHS values used in the calculation
+  /// @param cycles index_t The number of cycles
+  /// @return index_t The number of cycles performed
+  index_t Smooth(Grid *grid, const Grid *rhs, const index_t &cycles) const;
+
+  /// Adapts omega to the observed contraction if omega is chosen
+  /// automatically without an exact optimum. Below the optimum, the
+  /// contraction rate lambda of SOR and the spectral radius mu of the Jacobi
+  /// iteration are related by (lambda + omega - 1)^2 = lambda omega^2 mu^2,
+  /// which gives the optimal omega 2 / (1 + sqrt(1 - mu^2)). Above the
+  /// optimum the contraction is omega - 1, so omega is lowered a little to
+  /// measure again. A growing residual also lowers the upper bound of
+  /// omega.
+  ///
+  /// @param rate real_t The mean contraction of the residual per cycle at
+  ///   the end of the last solve
+  void Adapt(const real_t &rate);
+
+  /// Writes omega and its upper bound to a checkpoint.
+  ///
+  /// @param handle FILE* The opened checkpoint file
+  void WriteCheckpoint(FILE *handle) const;
+
+  /// Reads omega and its upper bound from a checkpoint.
+  ///
+  /// @param handle FILE* The opened checkpoint file
+  void ReadCheckpoint(FILE *handle);
+
+  /// Returns the optimal omega of SOR for the pressure-Poisson equation on
+  /// the given geometry, 2 / (1 + sqrt(1 - mu^2)) with the spectral radius
+  /// mu of the Jacobi iteration. For a rectangle without obstacles and with
+  /// one type of pressure boundary condition per side, mu follows from the
+  /// lowest eigenmodes of the operator and the result is exact. Otherwise the
+  /// bounding box with Dirichlet conditions is used, which underestimates the
+  /// optimum.
+  ///
+  /// @param geom Geometry The geometry
+  /// @param exact bool Returns whether the result is the exact optimum
+  /// @return real_t The optimal omega
+  static real_t OptimalOmega(const Geometry *geom, bool &exact);
+
 protected:
   /// _omega real_t The omega parameter
   real_t _omega;
+
+  /// _omega_max real_t The upper bound of the adapted omega
+  real_t _omega_max;
+
+  /// _adapt bool True if omega is adapted after each solve
+  bool _adapt;
+};
+
+//------------------------------------------------------------------------------
+
+/// The red-black SOR solver. The cells are coloured like a checkerboard and
+/// each cycle updates all cells of one colour before the other. Since a cell
+/// only depends on cells of the other colour, the cells within one half sweep
+/// can be updated in any order (and in parallel).
+class RedBlackSOR : public SOR {
+public:
+  /// Constructs a red-black SOR solver using the given geometry and omega
+  /// parameter.
+  ///
+  /// @param geom Geometry The geometry
+  /// @param omega real_t The omega parameter used in the calculation
+  RedBlackSOR(const Geometry *geom, const real_t &omega);
+
+  /// Deconstructs the RedBlackSOR instance.
+  ~RedBlackSOR();
+
+  /// Performs one cycle of the solver algorithm, i.e. a half sweep over the
+  /// red cells followed by a half sweep over the black cells, and returns
+  /// the residual after the calculation.
+  ///
+  /// @param grid Grid The current p values. This grid will be modified with the
+  ///   new values.
+  /// @param rhs Grid The RHS values used in the calculation
+  /// @return real_t The accumulated residual
+  real_t Cycle(Grid *grid, const Grid *rhs) const;
+
+  /// Performs the given number of cycles without computing the residual and
+  /// updates the boundary values after each of them. This saves the
+  /// reduction of the residual over all processes.
+  ///
+  /// @param grid Grid The current p values. This grid will be modified with the
+  ///   new values.
+  /// @param rhs Grid The RHS values used in the calculation
+  /// @param cycles index_t The number of cycles
+  /// @return index_t The number of cycles performed
+  index_t Smooth(Grid *grid, const Grid *rhs, const index_t &cycles) const;
+
+protected:
+  /// _mask real_t* Precomputed mask of the cells to update. Fluid cells get a
+  ///   value of 1.0, everything else 0.0.
+  real_t *_mask;
+
+  /// _n_fluid index_t The number of fluid cells
+  index_t _n_fluid;
+
+  /// Updates all cells of one colour and adds their squared residuals to res.
+  ///
+  /// @param grid Grid The current p values. This grid will be modified with the
+  ///   new values.
+  /// @param rhs Grid The RHS values used in the calculation
+  /// @param colour index_t The colour to update; 0 is red, 1 is black
+  /// @return accum_t The sum of the squared residuals of the updated cells
+  accum_t HalfSweep(Grid *grid, const Grid *rhs, const index_t &colour) const;
+
+  /// Updates all cells of one colour like HalfSweep without summing up the
+  /// residuals.
+  ///
+  /// @param grid Grid The current p values. This grid will be modified with the
+  ///   new values.
+  /// @param rhs Grid The RHS values used in the calculation
+  /// @param colour index_t The colour to update; 0 is red, 1 is black
+  void Relax(Grid *grid, const Grid *rhs, const index_t &colour) const;
+};
+
+//------------------------------------------------------------------------------
+
+/// The discrete pressure-Poisson operator with homogeneous boundary conditions
+/// on one level of a cell-centred grid hierarchy, together with the unknown,
+/// right-hand side and residual fields of that level.
+///
+/// The level consists of nx times ny interior cells surrounded by one layer of
+/// ghost cells. The finest level has exactly the layout of a Grid, so indices
+/// can be shared with the Grid. Each fluid cell stores the weights of its four
+/// neighbours and its diagonal entry. Boundary and obstacle neighbours are
+/// eliminated into the diagonal entry: a Neumann neighbour mirrors the cell
+/// value, a Dirichlet neighbour mirrors it with opposite sign.
+class PoissonLevel {
+public:
+  /// Constructs the finest level from the cell types of the given geometry.
+  ///
+  /// @param geom Geometry The geometry
+  PoissonLevel(const Geometry *geom);
+
+  /// Constructs a level by coarsening the given level by a factor of two in
+  /// each dimension. A coarse cell is a fluid cell if any of its children is
+  /// a fluid cell.
+  ///
+  /// @param fine PoissonLevel The level to coarsen
+  PoissonLevel(const PoissonLevel *fine);
+
+  /// Deconstructs the level.
+  ~PoissonLevel();
+
+  /// Returns the number of interior cells in x direction.
+  ///
+  /// @return index_t The number of interior cells in x direction
+  const index_t &Nx() const;
+
+  /// Returns the number of interior cells in y direction.
+  ///
+  /// @return index_t The number of interior cells in y direction
+  const index_t &Ny() const;
+
+  /// Returns the number of fluid cells.
+  ///
+  /// @return index_t The number of fluid cells
+  const index_t &NFluid() const;
+
+  /// Returns true if no cell has a Dirichlet neighbour, i.e. the operator is
+  /// only determined up to a constant.
+  ///
+  /// @return bool If the operator is singular
+  bool Singular() const;
+
+  /// Returns the unknown field of the level.
+  ///
+  /// @return real_t* The unknown field
+  real_t *X();
+
+  /// Returns the right-hand side field of the level.
+  ///
+  /// @return real_t* The right-hand side field
+  real_t *B();
+
+  /// Returns the residual field of the level.
+  ///
+  /// @return real_t* The residual field
+  real_t *R();
+
+  /// Applies the operator: y = A x. Non-fluid cells of y are set to zero.
+  ///
+  /// @param x real_t* The field to apply the operator on
+  /// @param y real_t* The result
+  void Apply(const real_t *x, real_t *y) const;
+
+  /// Performs red-black Gauss-Seidel sweeps on A x = b.
+  ///
+  /// @param x real_t* The unknown, modified in place
+  /// @param b real_t* The right-hand side
+  /// @param sweeps index_t The number of sweeps
+  void Smooth(real_t *x, const real_t *b, const index_t &sweeps) const;
+
+  /// Computes the residual r = b - A x.
+  ///
+  /// @param x real_t* The unknown
+  /// @param b real_t* The right-hand side
+  /// @param r real_t* The residual
+  /// @return accum_t The sum of the squared residuals over all fluid cells
+  accum_t Residual(const real_t *x, const real_t *b, real_t *r) const;
+
+  /// Sets the right-hand side of this level to the average of the residuals
+  /// of the children on the given finer level.
+  ///
+  /// @param fine PoissonLevel The finer level
+  void Restrict(const PoissonLevel *fine);
+
+  /// Interpolates the unknown of this level bilinearly and adds it to the
+  /// unknown of the given finer level.
+  ///
+  /// @param fine PoissonLevel The finer level
+  void Prolongate(PoissonLevel *fine) const;
+
+  /// Subtracts the mean over all fluid cells from the given field.
+  ///
+  /// @param x real_t* The field
+  void RemoveMean(real_t *x) const;
+
+  /// Returns the scalar product of two fields over all interior cells.
+  ///
+  /// @param a real_t* The first field
+  /// @param b real_t* The second field
+  /// @return accum_t The scalar product
+  accum_t Dot(const real_t *a, const real_t *b) const;
+
+  /// Applies the Jacobi preconditioner: z = D^-1 r.
+  ///
+  /// @param r real_t* The residual
+  /// @param z real_t* The preconditioned residual
+  void Jacobi(const real_t *r, real_t *z) const;
+
+  /// Applies the symmetric SOR preconditioner, i.e. one forward and one
+  /// backward lexicographic SOR sweep starting from zero.
+  ///
+  /// @param r real_t* The residual
+  /// @param z real_t* The preconditioned residual
+  /// @param omega real_t The relaxation parameter
+  void SSOR(const real_t *r, real_t *z, const real_t &omega) const;
+
+  /// Computes the pivots of the incomplete Cholesky factorization without
+  /// fill-in of the operator. Must be called once before SolveIC.
+  void FactorIC();
+
+  /// Applies the incomplete Cholesky preconditioner by a forward and a
+  /// backward substitution.
+  ///
+  /// @param r real_t* The residual
+  /// @param z real_t* The preconditioned residual
+  void SolveIC(const real_t *r, real_t *z) const;
+
+private:
+  /// _nx index_t The number of interior cells in x direction
+  index_t _nx;
+
+  /// _ny index_t The number of interior cells in y direction
+  index_t _ny;
+
+  /// _stride index_t The distance between two rows (_nx + 2)
+  index_t _stride;
+
+  /// _n_fluid index_t The number of fluid cells
+  index_t _n_fluid;
+
+  /// _singular bool True if no cell has a Dirichlet neighbour
+  bool _singular;
+
+  /// _wx real_t The weight of the x neighbours (inverse square mesh width)
+  real_t _wx;
+
+  /// _wy real_t The weight of the y neighbours (inverse square mesh width)
+  real_t _wy;
+
+  /// _fluid char* 1 for fluid cells, 0 for everything else
+  char *_fluid;
+
+  /// _dirichlet char* Bit field of the Dirichlet neighbours of each cell
+  ///   (1: left, 2: right, 4: down, 8: top)
+  char *_dirichlet;
+
+  /// _cl real_t* The weight of the left neighbour of each cell
+  real_t *_cl;
+
+  /// _cr real_t* The weight of the right neighbour of each cell
+  real_t *_cr;
+
+  /// _cd real_t* The weight of the lower neighbour of each cell
+  real_t *_cd;
+
+  /// _ct real_t* The weight of the upper neighbour of each cell
+  real_t *_ct;
+
+  /// _diag real_t* The diagonal entry of each cell
+  real_t *_diag;
+
+  /// _idiag real_t* The inverse diagonal entry of each fluid cell, zero for
+  ///   all other cells
+  real_t *_idiag;
+
+  /// _x real_t* The unknown field
+  real_t *_x;
+
+  /// _b real_t* The right-hand side field
+  real_t *_b;
+
+  /// _r real_t* The residual field
+  real_t *_r;
+
+  /// _ic real_t* The pivots of the incomplete Cholesky factorization of the
+  ///   negated operator; NULL until FactorIC is called
+  real_t *_ic;
+
+  /// Allocates all fields for the current size and sets them to zero.
+  void Allocate();
+
+  /// Computes the neighbour weights and diagonal entries from the fluid
+  /// flags and the Dirichlet bit fields and checks if the operator is
+  /// singular.
+  void Assemble();
+
+  /// Returns the value of x in the neighbour of cell k in the direction given
+  /// by offset and bit. Non-fluid neighbours are mirrored according to their
+  /// boundary condition.
+  ///
+  /// @param x real_t* The field
+  /// @param k index_t The cell
+  /// @param offset int The index offset to the neighbour
+  /// @param bit char The Dirichlet bit of the direction
+  /// @return real_t The value in the neighbour
+  real_t Neighbour(const real_t *x, const index_t &k, const int &offset, const char &bit) const;
+};
+
+//------------------------------------------------------------------------------
+
+/// A geometric multigrid solver. Each cycle computes the defect of the current
+/// pressure and reduces it with one V- or W-cycle on a hierarchy of
+/// PoissonLevel instances, using red-black Gauss-Seidel as smoother.
+class Multigrid : public Solver {
+public:
+  /// Constructs a multigrid solver using the given geometry.
+  ///
+  /// @param geom Geometry The geometry
+  /// @param gamma index_t The number of coarse grid corrections per level;
+  ///   1 gives a V-cycle, 2 a W-cycle
+  Multigrid(const Geometry *geom, const index_t &gamma);
+
+  /// Deconstructs the Multigrid instance.
+  ~Multigrid();
+
+  /// Performs one multigrid cycle and returns the residual after the
+  /// calculation.
+  ///
+  /// @param grid Grid The current p values. This grid will be modified with the
+  ///   new values.
+  /// @param rhs Grid The RHS values used in the calculation
+  /// @return real_t The accumulated residual
+  real_t Cycle(Grid *grid, const Grid *rhs) const;
+
+protected:
+  /// _gamma index_t The number of coarse grid corrections per level
+  index_t _gamma;
+
+  /// _n_levels index_t The number of levels
+  index_t _n_levels;
+
+  /// _levels PoissonLevel** The levels, beginning with the finest one
+  PoissonLevel **_levels;
+
+  /// Performs one cycle on the given level and all coarser ones.
+  ///
+  /// @param l index_t The level
+  void LevelCycle(const index_t &l) const;
+};
+//------------------------------------------------------------------------------
+
+/// A matrix-free preconditioned conjugate gradient solver. Each cycle computes
+/// the defect of the current pressure and solves for the correction with the
+/// conjugate gradient method on the operator of a PoissonLevel until the
+/// residual drops below the tolerance.
+class PCG : public Solver {
+public:
+  /// Constructs a PCG solver using the given geometry.
+  ///
+  /// @param geom Geometry The geometry
+  /// @param precond index_t The preconditioner
+  /// @see Enum PreconditionerType
+  /// @param omega real_t The relaxation parameter of the SSOR preconditioner
+  /// @param eps real_t The tolerance for the residual
+  /// @param itermax index_t The maximum number of iterations per cycle
+  PCG(const Geometry *geom, const index_t &precond, const real_t &omega,
+      const real_t &eps, const index_t &itermax);
+
+  /// Deconstructs the PCG instance.
+  ~PCG();
+
+  /// Solves for the correction of the current pressure and returns the
+  /// residual after the calculation.
+  ///
+  /// @param grid Grid The current p values. This grid will be modified with the
+  ///   new values.
+  /// @param rhs Grid The RHS values used in the calculation
+  /// @return real_t The accumulated residual
+  real_t Cycle(Grid *grid, const Grid *rhs) const;
+
+  /// Prints the number of iterations and the residual history of the last
+  /// cycle.
+  void Report() const;
+
+  /// Returns the number of iterations of the last cycle.
+  ///
+  /// @return index_t The number of iterations
+  const index_t &Iterations() const;
+
+  /// Returns the residual history of the last cycle. Entry i is the residual
+  /// after i iterations, so the history has Iterations() + 1 entries.
+  ///
+  /// @return real_t* The residual history
+  const real_t *History() const;
+
+protected:
+  /// _level PoissonLevel The operator; its fields hold the correction (X) and
+  ///   the residual (R)
+  PoissonLevel *_level;
+
+  /// _precond index_t The preconditioner
+  index_t _precond;
+
+  /// _omega real_t The relaxation parameter of the SSOR preconditioner
+  real_t _omega;
+
+  /// _eps real_t The tolerance for the residual
+  real_t _eps;
+
+  /// _itermax index_t The maximum number of iterations per cycle
+  index_t _itermax;
+
+  /// _z real_t* The preconditioned residual
+  real_t *_z;
+
+  /// _d real_t* The search direction
+  real_t *_d;
+
+  /// _q real_t* The operator applied to the search direction
+  real_t *_q;
+
+  /// _iterations index_t The number of iterations of the last cycle
+  mutable index_t _iterations;
+
+  /// _history real_t* The residual history of the last cycle
+  real_t *_history;
+
+  /// Applies the selected preconditioner.
+  ///
+  /// @param r real_t* The residual
+  /// @param z real_t* The preconditioned residual
+  void Precondition(const real_t *r, real_t *z) const;
+};
+//------------------------------------------------------------------------------
+
+/// Complex numbers used by the fast Fourier transform
+typedef std::complex<real_t> complex_t;
+
+/// A discrete sine or cosine transform of cell-centred values between two
+/// walls. Each wall is of Neumann or Dirichlet type, which selects one of the
+/// transforms DCT-II, DST-II, DCT-IV or DST-IV. Their basis vectors are the
+/// eigenvectors of the 1D Laplacian with the same boundary conditions. The
+/// transforms are computed with a complex FFT of length 2n, using Bluestein's
+/// algorithm if 2n is not a power of two.
+class TrigTransform {
+public:
+  /// Constructs a transform for n values.
+  ///
+  /// @param n index_t The number of values
+  /// @param left bool True if the left wall is of Dirichlet type
+  /// @param right bool True if the right wall is of Dirichlet type
+  /// @param weight real_t The weight of the neighbours in the Laplacian, 1/h^2
+  TrigTransform(const index_t &n, const bool &left, const bool &right,
+                const real_t &weight);
+
+  /// Deconstructs the TrigTransform instance.
+  ~TrigTransform();
+
+  /// Computes the coefficients of the given values in the basis.
+  ///
+  /// @param in real_t* The n values
+  /// @param out real_t* The n coefficients
+  void Forward(const real_t *in, real_t *out) const;
+
+  /// Computes the values from the coefficients, so that Backward is the
+  /// inverse of Forward.
+  ///
+  /// @param in real_t* The n coefficients
+  /// @param out real_t* The n values
+  void Backward(const real_t *in, real_t *out) const;
+
+  /// Returns the eigenvalues of the 1D Laplacian belonging to the basis
+  /// vectors.
+  ///
+  /// @return real_t* The n eigenvalues
+  const real_t *Eigenvalues() const;
+
+private:
+  /// _n index_t The number of values
+  index_t _n;
+
+  /// _m index_t The length of the radix-2 FFT
+  index_t _m;
+
+  /// _sine bool True for the sine transforms
+  bool _sine;
+
+  /// _pre complex_t* Twiddle factors applied to the input of Forward
+  complex_t *_pre;
+
+  /// _post complex_t* Twiddle factors applied to the output of Forward
+  complex_t *_post;
+
+  /// _ipre complex_t* Twiddle factors applied to the input of Backward
+  complex_t *_ipre;
+
+  /// _ipost complex_t* Twiddle factors applied to the output of Backward
+  complex_t *_ipost;
+
+  /// _roots complex_t* The roots of unity of the radix-2 FFT
+  complex_t *_roots;
+
+  /// _chirp complex_t* The chirp of Bluestein's algorithm, NULL if unused
+  complex_t *_chirp;
+
+  /// _chirp_hat complex_t* The transformed convolution kernel of Bluestein's
+  ///   algorithm, NULL if unused
+  complex_t *_chirp_hat;
+
+  /// _work complex_t* Scratch array of length _m
+  complex_t *_work;
+
+  /// _norm real_t* The inverse squared norms of the basis vectors
+  real_t *_norm;
+
+  /// _lambda real_t* The eigenvalues of the basis vectors
+  real_t *_lambda;
+
+  /// Computes the DFT of length 2n of the first 2n entries of a in place.
+  ///
+  /// @param a complex_t* The array of length _m
+  void DFT(complex_t *a) const;
+
+  /// Computes the radix-2 FFT of length _m in place.
+  ///
+  /// @param a complex_t* The array of length _m
+  /// @param inverse bool True for the inverse transform without scaling
+  void FFT(complex_t *a, const bool &inverse) const;
+};
+//------------------------------------------------------------------------------
+
+/// A direct solver for the pressure on rectangular domains without obstacles.
+/// The defect of the current pressure is transformed with a TrigTransform in
+/// x direction, which decouples the Poisson equation into one tridiagonal
+/// system per wave number. These are solved in y direction and transformed
+/// back, so a single cycle solves the problem up to round-off.
+class FFTSolver : public Solver {
+public:
+  /// Constructs a FFT solver using the given geometry.
+  ///
+  /// @see FFTSolver::Applicable
+  /// @param geom Geometry The geometry
+  FFTSolver(const Geometry *geom);
+
+  /// Deconstructs the FFT solver instance.
+  ~FFTSolver();
+
+  /// Solves for the correction of the current pressure and returns the
+  /// residual after the calculation.
+  ///
+  /// @param grid Grid The current p values. This grid will be modified with the
+  ///   new values.
+  /// @param rhs Grid The RHS values used in the calculation
+  /// @return real_t The accumulated residual
+  real_t Cycle(Grid *grid, const Grid *rhs) const;
+
+  /// Checks if the geometry can be solved directly: there are no obstacles
+  /// inside the domain and each boundary has a single type of pressure
+  /// boundary condition.
+  ///
+  /// @param geom Geometry The geometry
+  /// @return bool True if the FFT solver can be used
+  static bool Applicable(const Geometry *geom);
+
+protected:
+  /// _nx index_t The number of interior cells in x direction
+  index_t _nx;
+
+  /// _ny index_t The number of interior cells in y direction
+  index_t _ny;
+
+  /// _singular bool True if the pressure is only determined up to a constant
+  bool _singular;
+
+  /// _transform TrigTransform The transform in x direction
+  TrigTransform *_transform;
+
+  /// _cp real_t* The modified upper diagonals of the tridiagonal systems, one
+  ///   column of length _ny per wave number
+  real_t *_cp;
+
+  /// _ipivot real_t* The inverted pivots of the tridiagonal systems
+  real_t *_ipivot;
+
+  /// _b real_t* The defect and later the correction, row by row
+  real_t *_b;
+
+  /// _bh real_t* The transformed defect and correction, row by row
+  real_t *_bh;
+
+  /// Removes the mean from the given values.
+  ///
+  /// @param x real_t* The _nx * _ny values
+  void RemoveMean(real_t *x) const;
 };
 //------------------------------------------------------------------------------
 #endif // __SOLVER_HPP
@@ -2,6 +2,7 @@
 #include "typedef.hpp"
 #include "geometry.hpp"
 #include "grid.hpp"
+#include "communicator.hpp"
 
 #include <cstdio>  // file methods
 #include <cstring> // string
@@ -17,27 +18,27 @@ Substance::Substance(const Geometry *geom) : _geom(geom){
 Substance::~Substance() {
   for (index_t i=0; i<_n; ++i){
     delete _c[i];
+    delete _c_next[i];
     delete[] _r[i];
   }
   delete[] _c;
+  delete[] _c_next;
   delete[] _r;
 
   delete[] _l;
-  delete[] _rt;
   delete[] _gamma;
   delete[] _d;
 }
 
 void Substance::DefaultInit() {
+  this->BakePlans();
+
   _n        = index_t(1);
 
   _r        = new real_t*[_n];
   _r[0]     = new real_t[_n];
   _r[0][0]  = real_t(0.0001);
 
-  _rt        = new real_t[_n];
-  _rt[0]     = real_t(0.0);
-
   _gamma    = new real_t[_n];
   _gamma[0] = real_t(0.5);
 
@@ -52,8 +53,10 @@ void Substance::DefaultInit() {
   offset_c[0] = _geom->Mesh()[0]/2.0;
   offset_c[1] = _geom->Mesh()[1]/2.0;
   
-  _c    = new Grid*[_n];
-  _c[0] = new Grid(_geom, offset_c);
+  _c         = new Grid*[_n];
+  _c[0]      = new Grid(_geom, offset_c);
+  _c_next    = new Grid*[_n];
+  _c_next[0] = new Grid(_geom, offset_c);
   
   // Turn Grey-Scott off
   _k = 0;
@@ -64,6 +67,9 @@ void Substance::DefaultInit() {
 }
 
 void Substance::Load(const char *file){
+  // The initial concentrations set their boundary values while loading
+  this->BakePlans();
+
   FILE* handle = fopen(file, "r");
 
   double inval[2];
@@ -82,18 +88,19 @@ void Substance::Load(const char *file){
         // Create n new concentrations
         _gamma = new real_t[_n];
         _r     = new real_t*[_n];
-        _rt    = new real_t[_n];
         _l     = new real_t[_n];
         _d     = new real_t[_n];
         _c     = new Grid*[_n];
+        _c_next = new Grid*[_n];
         
         multi_real_t offset_c;
         offset_c[0] = _geom->Mesh()[0]/2.0;
         offset_c[1] = _geom->Mesh()[1]/2.0;
         
         for (index_t cc=0; cc<_n; ++cc){
-          _c[cc] = new Grid(_geom, offset_c);
-          _r[cc] = new real_t[_n];
+          _c[cc]      = new Grid(_geom, offset_c);
+          _c_next[cc] = new Grid(_geom, offset_c);
+          _r[cc]      = new real_t[_n];
         }
         
         // Turn Grey-Scott off
@@ -222,6 +229,33 @@ void Substance::Load(const char *file){
   }
 }
 
+void Substance::Decompose() {
+  const multi_index_t &size   = _geom->Size();
+  const multi_index_t &total  = _geom->TotalSize();
+  const multi_index_t &offset = _geom->Offset();
+
+  multi_real_t offset_c;
+  offset_c[0] = _geom->Mesh()[0]/2.0;
+  offset_c[1] = _geom->Mesh()[1]/2.0;
+
+  // Cut the own block including the ghost cells out of the global grids
+  for (index_t cc=0; cc<_n; ++cc) {
+    Grid *c = new Grid(_geom, offset_c);
+
+    for (index_t j = 0; j < size[1]; ++j)
+      for (index_t i = 0; i < size[0]; ++i)
+        c->Cell(j * size[0] + i) = _c[cc]->Cell((j + offset[1]) * total[0] + i + offset[0]);
+
+    delete _c[cc];
+    delete _c_next[cc];
+    _c[cc]      = c;
+    _c_next[cc] = new Grid(_geom, offset_c);
+    _c_next[cc]->CopyFrom(c);
+  }
+
+  this->BakePlans();
+}
+
 const Grid *Substance::GetC(const index_t n_subst) const{
   if (n_subst < _n) {
     return _c[n_subst];
@@ -242,64 +276,116 @@ const index_t &Substance::N() const{
   return _n;
 }
 
-void Substance::NewConcentrations(const real_t &dt, const Grid *u, const Grid *v) const{
-  InteriorIterator init(_geom);
+void Substance::WriteCheckpoint(FILE *handle) const{
+  for (index_t i=0; i<_n; ++i)
+    _c[i]->Write(handle);
+}
 
-  // Cycle to compute c
-  for (init.First(); init.Valid(); init.Next()) {
-    if (_geom->CellTypeAt(init) == CellType::Fluid) {
-      
-      // Calculate inter-dependant reaction terms first, since they will change
-      // during calculation
-      for (index_t self=0; self < _n; self++) {
-        _rt[self] = real_t(0.0);
-        for (index_t other=0; other < _n; other++) {
-          if (self != other) {
-            _rt[self] += _r[self][other] * _c[self]->Cell(init) * _c[other]->Cell(init);
-          }
-        }
+void Substance::ReadCheckpoint(FILE *handle){
+  for (index_t i=0; i<_n; ++i) {
+    _c[i]->Read(handle);
+    _c_next[i]->CopyFrom(_c[i]);
+  }
+}
+
+SIMD_CLONES void Substance::NewConcentrations(const real_t &dt, const Grid *u, const Grid *v) const{
+  const index_t *seg   = _geom->FluidSegments();
+  const index_t  n_seg = _geom->NFluidSegments();
+
+  // Cycle to compute c segment by segment. The new values are written to
+  // _c_next, so all stencils see the concentrations of the previous time
+  // step. Each substance is updated in its own pass over the segment. The
+  // segments only contain fluid cells; obstacles keep their values, since
+  // _c_next starts as a copy of _c and Update_C sets the obstacle cells next
+  // to the fluid after each swap.
+  OMP_FOR
+  for (index_t s = 0; s < n_seg; ++s) {
+    const index_t first = seg[2 * s];
+    const index_t last  = seg[2 * s + 1];
+
+    // Reaction terms of the cells in the segment (used in synchronous calculation)
+    const index_t n = last - first;
+    real_t *rt = new real_t[n];
+
+    for (index_t self=0; self < _n; self++) {
+      const Grid   *c  = _c[self];
+      const real_t *cs = c->Data();
+      real_t       *cn = _c_next[self]->Data();
+
+      const real_t d     = _d[self];
+      const real_t gamma = _gamma[self];
+      const real_t rs    = _r[self][self];
+      const real_t l     = _l[self];
+
+      // Calculate inter-dependant reaction terms first
+      for (index_t i = 0; i < n; ++i)
+        rt[i] = real_t(0.0);
+      for (index_t other=0; other < _n; other++) {
+        if (self == other)
+          continue;
+        const real_t  r  = _r[self][other];
+        const real_t *cr = cs + first;
+        const real_t *co = _c[other]->Data() + first;
+        SIMD_LOOP
+        for (index_t i = 0; i < n; ++i)
+          rt[i] += r * cr[i] * co[i];
       }
 
-      // Cycle concentrations
-      for (index_t self=0; self<_n; self++) {
-        _c[self]->Cell(init) =
+      SIMD_LOOP
+      for (index_t k = first; k < last; ++k) {
+        cn[k] =
           // previous value
-          _c[self]->Cell(init)
+          cs[k]
           // diffusion term
-          + dt * _d[self] * (_c[self]->dxx(init) + _c[self]->dyy(init))
+          + dt * d * (c->dxx(k) + c->dyy(k))
           // x direction convection term
-          - dt * _c[self]->DC_dCu_x(init, _gamma[self], u)
+          - dt * c->DC_dCu_x(k, gamma, u)
           // y direction convection term
-          - dt * _c[self]->DC_dCv_y(init, _gamma[self], v)
+          - dt * c->DC_dCv_y(k, gamma, v)
           // quadratic reaction term (self-dependent only)
-          + dt * _r[self][self] * _c[self]->Cell(init) * (_l[self] - _c[self]->Cell(init))/_l[self]
+          + dt * rs * cs[k] * (l - cs[k])/l
           // inter-dependent reaction terms (calculated above)
-          + dt * _rt[self];
+          + dt * rt[k - first];
       }
-      
-      if (_useGS) {
-        _c[0]->Cell(init) = 
+    }
+
+    delete[] rt;
+    
+    if (_useGS) {
+      real_t *a = _c_next[0]->Data();
+      real_t *b = _c_next[1]->Data();
+
+      SIMD_LOOP
+      for (index_t k = first; k < last; ++k) {
+        const real_t na =
           // previous value
-          _c[0]->Cell(init)
+          a[k]
           // reaction
-          - dt * _c[0]->Cell(init) * _c[1]->Cell(init) * _c[1]->Cell(init)
+          - dt * a[k] * b[k] * b[k]
           // feed
-          + dt * _f *(1.0 - _c[0]->Cell(init));
+          + dt * _f *(1.0 - a[k]);
         
-        _c[1]->Cell(init) = 
+        const real_t nb =
           // previous value
-          _c[1]->Cell(init)
+          b[k]
           // reaction
-          + dt * _c[0]->Cell(init) * _c[1]->Cell(init) * _c[1]->Cell(init)
+          + dt * na * b[k] * b[k]
           // kill
-          - dt * (_k+_f) * _c[1]->Cell(init);
+          - dt * (_k+_f) * b[k];
+
+        a[k] = na;
+        b[k] = nb;
       }
     }
   }
   
-  // Apply boundary condition
-  for (index_t cc=0; cc<_n; ++cc)
+  // Swap in the new concentrations and apply boundary condition
+  for (index_t cc=0; cc<_n; ++cc) {
+    Grid *tmp    = _c[cc];
+    _c[cc]       = _c_next[cc];
+    _c_next[cc]  = tmp;
     this->Update_C(_c[cc]);
+  }
   
 //   // Spawn B source
 //   this->InitSquare(_c[1], multi_real_t({0.9, 0.9}), 0.1, 0.1, 1.0);
@@ -309,89 +395,110 @@ void Substance::NewConcentrations(const real_t &dt, const Grid *u, const Grid *v
  *                            PRIVATE FUNCTIONS                            *
  ***************************************************************************/
 
-void Substance::Update_C(Grid *c) const{
+void Substance::BakePlans() {
+  const Communicator *comm = _geom->Comm();
   BoundaryIterator boit(_geom, 1);
-  
-  // Set left boundary
-  boit.SetBoundary(4);
-  this->CycleBoundary_C(c, boit);
-  
-  // Set right boundary
-  boit.SetBoundary(2);
-  this->CycleBoundary_C(c, boit);
-  
-  // Set lower boundary
-  boit.SetBoundary(1);
-  this->CycleBoundary_C(c, boit);
 
-  // Set upper boundary
-  boit.SetBoundary(3);
-  this->CycleBoundary_C(c, boit);
+  _boundary_c.Clear();
+  _obstacle_c.Clear();
+
+  // Set the left, right, lower and upper boundary, if they belong to the
+  // domain boundary
+  const index_t sides[4] = {4, 2, 1, 3};
+
+  for (index_t s = 0; s < 4; ++s) {
+    if (!comm->IsBoundary(sides[s])) continue;
+
+    boit.SetBoundary(sides[s]);
+    this->CycleBoundary_C(&_boundary_c, boit);
+  }
   
-  // Set corners to avg of neighbour cells
-  Iterator cbl = boit.CornerBottomLeft();
-  c->Cell(cbl) = (c->Cell(cbl.Right()) + c->Cell(cbl.Top()))/2.0;
+  // Set corners of the domain to avg of neighbour cells
+  if (comm->IsBoundary(1) && comm->IsBoundary(4)) {
+    Iterator cbl = boit.CornerBottomLeft();
+    _boundary_c.Average(cbl, cbl.Right(), cbl.Top(), 0.5);
+  }
   
-  Iterator cbr = boit.CornerBottomRight();
-  c->Cell(cbr) = (c->Cell(cbr.Left()) + c->Cell(cbr.Top()))/2.0;
+  if (comm->IsBoundary(1) && comm->IsBoundary(2)) {
+    Iterator cbr = boit.CornerBottomRight();
+    _boundary_c.Average(cbr, cbr.Left(), cbr.Top(), 0.5);
+  }
   
-  Iterator ctl = boit.CornerTopLeft();
-  c->Cell(ctl) = (c->Cell(ctl.Right()) + c->Cell(ctl.Down()))/2.0;
+  if (comm->IsBoundary(3) && comm->IsBoundary(4)) {
+    Iterator ctl = boit.CornerTopLeft();
+    _boundary_c.Average(ctl, ctl.Right(), ctl.Down(), 0.5);
+  }
   
-  Iterator ctr = boit.CornerTopRight();
-  c->Cell(ctr) = (c->Cell(ctr.Left()) + c->Cell(ctr.Down()))/2.0;
+  if (comm->IsBoundary(3) && comm->IsBoundary(2)) {
+    Iterator ctr = boit.CornerTopRight();
+    _boundary_c.Average(ctr, ctr.Left(), ctr.Down(), 0.5);
+  }
 
   ObstacleIterator oit = ObstacleIterator(_geom);
 
   for(; oit.Valid(); oit.Next()) {
     switch (_geom->BakedNeighbors(oit)) {
       case 13:
-        c->Cell(oit) = -c->Cell(oit.Top());
+        _obstacle_c.Linear(oit, oit.Top(), -1.0, 0.0);
         break;
 
       case 11:
-        c->Cell(oit) = -c->Cell(oit.Right());
+        _obstacle_c.Linear(oit, oit.Right(), -1.0, 0.0);
         break;
 
       case 7:
-        c->Cell(oit) = -c->Cell(oit.Down());
+        _obstacle_c.Linear(oit, oit.Down(), -1.0, 0.0);
         break;
 
       case 14:
-        c->Cell(oit) = -c->Cell(oit.Left());
+        _obstacle_c.Linear(oit, oit.Left(), -1.0, 0.0);
         break;
 
       case 3:
-        c->Cell(oit) = -0.5 * (c->Cell(oit.Right()) + c->Cell(oit.Down()));
+        _obstacle_c.Average(oit, oit.Right(), oit.Down(), -0.5);
         break;
 
       case 9:
-        c->Cell(oit) = -0.5 * (c->Cell(oit.Right()) + c->Cell(oit.Top()));
+        _obstacle_c.Average(oit, oit.Right(), oit.Top(), -0.5);
         break;
 
       case 12:
-        c->Cell(oit) = -0.5 * (c->Cell(oit.Left()) + c->Cell(oit.Top()));
+        _obstacle_c.Average(oit, oit.Left(), oit.Top(), -0.5);
         break;
 
       case 6:
-        c->Cell(oit) = -0.5 * (c->Cell(oit.Left()) + c->Cell(oit.Down()));
+        _obstacle_c.Average(oit, oit.Left(), oit.Down(), -0.5);
         break;
     }
   }
 }
 
-void Substance::CycleBoundary_C(Grid *c, BoundaryIterator boit) const{
+void Substance::Update_C(Grid *c) const{
+  const Communicator *comm = _geom->Comm();
+
+  _boundary_c.Apply(c);
+
+  // Get the ghost cells of the other sides from the neighbouring blocks
+  comm->CopyBoundary(c);
+
+  _obstacle_c.Apply(c);
+
+  // Pass the values of obstacles on to the neighbouring blocks
+  comm->CopyBoundary(c);
+}
+
+void Substance::CycleBoundary_C(BoundaryPlan *plan, BoundaryIterator boit) const{
   for (; boit.Valid(); boit.Next())
     switch(_geom->CellTypeAt(boit)){
 
       // In the following, we can reuse the pressure methods, since they work
       // the same for the concentration
       case CellType::Obstacle:
-        this->SetCDirichlet(c, boit, 0.0);
+        this->SetCDirichlet(plan, boit, 0.0);
         break;
         
       case CellType::Inflow:
-        this->SetCNeumann(c, boit, 0.0);
+        this->SetCNeumann(plan, boit, 0.0);
         break;
         
       case CellType::H_Inflow:
@@ -399,19 +506,19 @@ void Substance::CycleBoundary_C(Grid *c, BoundaryIterator boit) const{
         break;
         
       case CellType::V_Inflow:
-        this->SetCNeumann(c, boit, 0.0);
+        this->SetCNeumann(plan, boit, 0.0);
         break;
         
       case CellType::Outflow:
-        this->SetCNeumann(c, boit, 0.0);
+        this->SetCNeumann(plan, boit, 0.0);
         break;
         
       case CellType::V_Slip:
-        this->SetCNeumann(c, boit, 0.0);
+        this->SetCNeumann(plan, boit, 0.0);
         break;
         
       case CellType::H_Slip:
-        this->SetCNeumann(c, boit, 0.0);
+        this->SetCNeumann(plan, boit, 0.0);
         break;
         
       default:
@@ -420,26 +527,26 @@ void Substance::CycleBoundary_C(Grid *c, BoundaryIterator boit) const{
     }
 }
 
-void Substance::SetCDirichlet(Grid *c, const BoundaryIterator &boit, const real_t &value) const{
+void Substance::SetCDirichlet(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const{
   switch(boit.Boundary()){
     // Set lower boundary
     case 1:
-      c->Cell(boit) = 2 * value - c->Cell(boit.Top());
+      plan->Linear(boit, boit.Top(), -1.0, 2 * value);
       break;
       
     // Set right boundary
     case 2:
-      c->Cell(boit) = 2 * value - c->Cell(boit.Left());
+      plan->Linear(boit, boit.Left(), -1.0, 2 * value);
       break;
       
     // Set upper boundary
     case 3:
-      c->Cell(boit) = 2 * value - c->Cell(boit.Down());
+      plan->Linear(boit, boit.Down(), -1.0, 2 * value);
       break;
       
     // Set left boundary
     case 4:
-      c->Cell(boit) = 2 * value - c->Cell(boit.Right());
+      plan->Linear(boit, boit.Right(), -1.0, 2 * value);
       break;
       
     default:
@@ -448,26 +555,26 @@ void Substance::SetCDirichlet(Grid *c, const BoundaryIterator &boit, const real_
   }
 }
 
-void Substance::SetCNeumann(Grid *c, const BoundaryIterator &boit, const real_t &value) const{
+void Substance::SetCNeumann(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const{
   switch(boit.Boundary()){
     // Set lower boundary
     case 1:
-      c->Cell(boit) = c->Cell(boit.Top()) - _geom->Mesh()[1] * value;
+      plan->Linear(boit, boit.Top(), 1.0, -_geom->Mesh()[1] * value);
       break;
       
     // Set right boundary
     case 2:
-      c->Cell(boit) = c->Cell(boit.Left()) + _geom->Mesh()[0] * value;
+      plan->Linear(boit, boit.Left(), 1.0, _geom->Mesh()[0] * value);
       break;
       
     // Set upper boundary
     case 3:
-      c->Cell(boit) = c->Cell(boit.Down()) + _geom->Mesh()[1] * value;
+      plan->Linear(boit, boit.Down(), 1.0, _geom->Mesh()[1] * value);
       break;
       
     // Set left boundary
     case 4:
-      c->Cell(boit) = c->Cell(boit.Right()) - _geom->Mesh()[0] * value;
+      plan->Linear(boit, boit.Right(), 1.0, -_geom->Mesh()[0] * value);
       break;
       
     default:
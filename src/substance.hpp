@@ -23,6 +23,12 @@ public:
   ///
   ///  @param file char* File path as char array
   void Load(const char *file);
+
+  /// Restricts the concentrations to the block of the calling process. Must
+  /// be called after the geometry has been decomposed.
+  ///
+  /// @see Geometry::Decompose()
+  void Decompose();
   
   /// Returns the pointer to substance n_subst.
   ///
@@ -49,6 +55,16 @@ public:
   /// @param v real_t The velocity v
   void NewConcentrations(const real_t &dt, const Grid *u, const Grid *v) const;
 
+  /// Writes the concentrations of all substances to a checkpoint.
+  ///
+  /// @param handle FILE* The opened checkpoint file
+  void WriteCheckpoint(FILE *handle) const;
+
+  /// Restores the concentrations written by WriteCheckpoint.
+  ///
+  /// @param handle FILE* The opened checkpoint file
+  void ReadCheckpoint(FILE *handle);
+
 private:
   /// _n index_t The number of substances
   index_t _n;
@@ -65,9 +81,6 @@ private:
   /// _r real_t Reaction coefficients
   real_t **_r;
 
-  /// _rt real_t Reaction terms (used in synchronous calculation)
-  real_t *_rt;
-
   /// _l real_t Reaction limits (population limit)
   real_t *_l;
   
@@ -86,29 +99,46 @@ private:
   /// _c Grid Array holding all Grid instances of substances
   Grid **_c;
   
+  /// _c_next Grid Array holding the Grid instances the next concentrations
+  ///   are written to. Swapped with _c after each time step.
+  Grid **_c_next;
+
+  /// _boundary_c BoundaryPlan The updates of the concentrations on the domain
+  ///   boundary of the own block
+  BoundaryPlan _boundary_c;
+
+  /// _obstacle_c BoundaryPlan The updates of the concentrations next to
+  ///   obstacles
+  BoundaryPlan _obstacle_c;
+
+  /// Compiles the boundary plans of the concentrations for the current
+  /// geometry. Must be called again when the geometry is decomposed.
+  void BakePlans();
+  
   /// Updates the concentration field c at the boundaries by applying the
   /// boundary values to them.
   ///
   /// @param c Grid The concentration field c
   void Update_C(Grid *c) const;
   
-  /// Cycle the full boundary given by BoundaryIterator boit on Grid c
+  /// Cycle the full boundary given by BoundaryIterator boit and append the
+  /// updates of c to the plan
   ///
-  /// @param c Grid The concentration field c
+  /// @param plan BoundaryPlan The plan of the concentration field c
   /// @param boit BoundaryIterator Boundary to iterate until boit.Valid() equals false
-  void CycleBoundary_C(Grid *c, BoundaryIterator boit) const;
+  void CycleBoundary_C(BoundaryPlan *plan, BoundaryIterator boit) const;
   /// 
-  /// @param c Grid The concentration field c
+  /// @param plan BoundaryPlan The plan of the concentration field c
   /// @param boit BoundaryIterator Position to set boundary condition
   /// @param value real_t Value to set as boundary condition
-  void SetCDirichlet(Grid *c, const BoundaryIterator &boit, const real_t &value) const;
+  void SetCDirichlet(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const;
   
-  /// Sets Neumann boundary condition for Grid u on boundary boit.Boundary() at position boit to value
+  /// Sets Neumann boundary condition in the plan on boundary boit.Boundary() at position boit to value
   /// 
-  /// @param c Grid The concentration field c
+  /// @param plan BoundaryPlan The plan of the concentration field c
   /// @param boit BoundaryIterator Position to set boundary condition
   /// @param value real_t Value to set as boundary condition
-  void SetCNeumann(Grid *c, const BoundaryIterator &boit, const real_t &value) const;
+  void SetCNeumann(BoundaryPlan *plan, const BoundaryIterator &boit, const real_t &value) const;
   
   /// Init substance with a circle at the position center with radius r.
   /// 
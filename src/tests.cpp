@@ -208,8 +208,8 @@ void test_grid() {
   it = it.Left().Top();
 
   printf("Interpolate: %f (%f)\n", grid.Interpolate({
-    0.5 / (geo.Size()[0] - 2),
-    0.5 / (geo.Size()[1] - 2)
+    real_t(0.5 / (geo.Size()[0] - 2)),
+    real_t(0.5 / (geo.Size()[1] - 2))
   }), 1.5);
 
   // Test difference quotient of first order for the middle cell
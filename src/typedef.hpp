@@ -35,14 +35,65 @@ using std::list;
 //------------------------------------------------------------------------------
 
 #define DIM 2
-#define REAL_TYPE double
 #define INDEX_TYPE uint32_t
 
+// The fields are stored in single precision if the program is built with the
+// "float" option. Sums over many cells like residuals and scalar products are
+// always accumulated in double precision.
+#ifdef USE_FLOAT
+#define REAL_TYPE float
+#else
+#define REAL_TYPE double
+#endif // USE_FLOAT
+#define ACCUM_TYPE double
+
+//------------------------------------------------------------------------------
+
+// Loops are distributed across threads with OpenMP if the program is built
+// with the "omp" option. Otherwise the macros below expand to nothing.
+#ifdef USE_OPENMP
+#define OMP_PRAGMA(x) _Pragma(#x)
+#else
+#define OMP_PRAGMA(x)
+#endif
+
+/// Distributes the iterations of the following for loop across threads
+#define OMP_FOR OMP_PRAGMA(omp parallel for schedule(static))
+
+/// Same as OMP_FOR, combining the private copies of var with the operator op
+#define OMP_FOR_REDUCE(op, var) OMP_PRAGMA(omp parallel for schedule(static) reduction(op:var))
+
+// The hot stencil loops are vectorized with OpenMP SIMD directives if the
+// program is built with the "simd" option. The functions containing them are
+// compiled for several instruction sets, the best variant for the CPU is
+// chosen when the program starts and the plain variant is the fallback.
+#ifdef USE_SIMD
+#define SIMD_PRAGMA(x) _Pragma(#x)
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#endif // __GNUC__
+#else
+#define SIMD_PRAGMA(x)
+#endif // USE_SIMD
+
+#ifndef SIMD_CLONES
+#define SIMD_CLONES
+#endif // SIMD_CLONES
+
+/// Vectorizes the following loop. Its iterations must be independent.
+#define SIMD_LOOP SIMD_PRAGMA(omp simd)
+
+/// Same as SIMD_LOOP, combining the partial results of var with the operator op
+#define SIMD_LOOP_REDUCE(op, var) SIMD_PRAGMA(omp simd reduction(op:var))
+
 //------------------------------------------------------------------------------
 
 /// Typedef for reals
 typedef REAL_TYPE real_t;
 
+/// Typedef for reals accumulating sums over many values
+typedef ACCUM_TYPE accum_t;
+
 /// Typedef for integers
 typedef INDEX_TYPE index_t;
 
@@ -67,6 +118,43 @@ enum CellType {
 
 //------------------------------------------------------------------------------
 
+/// An enum for the available pressure solvers. The number is the value of the
+/// "solver" entry in the parameter file.
+enum SolverType {
+  SOR_Lexicographic = 0,
+  SOR_RedBlack = 1,
+  Multigrid_V = 2,
+  Multigrid_W = 3,
+  PCG_Solver = 4,
+  FFT_Direct = 5
+};
+
+/// An enum for the preconditioners of the PCG solver. The number is the value
+/// of the "precond" entry in the parameter file.
+enum PreconditionerType {
+  Precond_Jacobi = 0,
+  Precond_SSOR = 1,
+  Precond_IC = 2
+};
+
+/// An enum for the fields derived from the velocities. The values are bit
+/// flags, so several fields can be requested at once.
+enum DerivedField {
+  Derived_Velocity = 1,
+  Derived_Vorticity = 2,
+  Derived_Stream = 4
+};
+
+/// An enum for the encodings of the VTK files. The number is the value of the
+/// "vtkformat" entry in the parameter file.
+enum VTKFormat {
+  VTK_ASCII = 0,
+  VTK_Binary = 1,
+  VTK_Compressed = 2
+};
+
+//------------------------------------------------------------------------------
+
 /// Template for array/vector types
 template <typename _type, uint32_t _dim> struct array_t {
   // Constructors
@@ -129,6 +217,10 @@ class Parameter;
 class Solver;
 class Compute;
 class CSV;
+class VTK;
+class Output;
 class Substance;
+class Communicator;
+class Particles;
 
 #endif // __TYPEDEF_HPP
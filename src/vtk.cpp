@@ -16,54 +16,184 @@
  */
 
 #include "vtk.hpp"
+#include "communicator.hpp"
+#include "particles.hpp"
 #include <cstring>
 #include <cstdio>
+#include <stdexcept>
+#include <zlib.h>
+//------------------------------------------------------------------------------
+// Compression level of the zlib encoding. The output is written while the
+// simulation waits, so speed is preferred over the size of the files
+#define VTK_ZLIB_LEVEL Z_BEST_SPEED
 //------------------------------------------------------------------------------
 uint32_t VTK::_cnt = 0;
 //------------------------------------------------------------------------------
+/// Returns the value of a grid at a mesh point, given the index of the lower
+/// left of the four surrounding cells and their weights
+static inline double Weighted(const real_t *data, const index_t &k,
+                              const index_t &stride, const real_t *weight) {
+  return data[k] * weight[0] + data[k + 1] * weight[1] +
+         data[k + stride] * weight[2] + data[k + stride + 1] * weight[3];
+}
+//------------------------------------------------------------------------------
+/// Appends the bytes of a value to a buffer
+template <typename _type>
+static void AppendBytes(std::string &buffer, const _type &value) {
+  buffer.append((const char *)&value, sizeof(_type));
+}
+//------------------------------------------------------------------------------
 VTK::VTK(const multi_real_t &h, const multi_index_t &size)
     : _h(h), _size(size) {
   _offset = multi_real_t(0.0);
   _handle = NULL;
+  _comm = NULL;
+  _format = VTKFormat::VTK_ASCII;
+  _series = false;
 }
 //------------------------------------------------------------------------------
 VTK::VTK(const multi_real_t &h, const multi_index_t &size,
          const multi_real_t &offset)
     : _h(h), _size(size), _offset(offset) {
   _handle = NULL;
+  _comm = NULL;
+  _format = VTKFormat::VTK_ASCII;
+  _series = false;
+}
+//------------------------------------------------------------------------------
+VTK::VTK(const multi_real_t &h, const multi_index_t &size,
+         const Communicator *comm)
+    : _h(h), _size(size), _comm(comm) {
+  for (uint32_t d = 0; d < DIM; ++d)
+    _offset[d] = (double)comm->BlockOffset()[d] * _h[d];
+  _handle = NULL;
+  _format = VTKFormat::VTK_ASCII;
+  _series = false;
+}
+//------------------------------------------------------------------------------
+uint32_t VTK::Count() { return _cnt; }
+//------------------------------------------------------------------------------
+void VTK::SetCount(const uint32_t &count) { _cnt = count; }
+//------------------------------------------------------------------------------
+void VTK::SetFormat(const index_t &format) {
+  if (format > VTKFormat::VTK_Compressed)
+    throw std::runtime_error("Unknown VTK format");
+  _format = format;
+}
+//------------------------------------------------------------------------------
+void VTK::SetSeries(const bool &series) {
+  _series = series;
+}
+//------------------------------------------------------------------------------
+void VTK::Init(const char *path, const real_t &time) {
+  if (_handle)
+    return;
+  this->Init(path);
+
+  // The collection lies in the same folder as the files it lists
+  const size_t slash = _path.rfind('/');
+  const std::string name =
+      slash == std::string::npos ? _path : _path.substr(slash + 1);
+  const bool parallel = _comm && _comm->ThreadCnt() > 1;
+
+  char entry[128];
+  snprintf(entry, sizeof(entry),
+           "<DataSet timestep=\"%le\" part=\"0\" file=\"%s_%i.%s\"/>\n",
+           (double)time, name.c_str(), _cnt,
+           parallel ? (_series ? "pvti" : "pvts") : (_series ? "vti" : "vts"));
+  std::string &collection = _collections[_path];
+  collection += entry;
+
+  // All processes write the same collection, the first one writes it. It is
+  // rewritten for every file, so it is complete even if the run is aborted
+  if (_comm && _comm->ThreadNum() != 0)
+    return;
+  FILE *handle = fopen((_path + ".pvd").c_str(), "w");
+  fprintf(handle, "<?xml version=\"1.0\"?>\n");
+  fprintf(handle, "<VTKFile type=\"Collection\" version=\"0.1\">\n");
+  fprintf(handle, "<Collection>\n%s</Collection>\n", collection.c_str());
+  fprintf(handle, "</VTKFile>\n");
+  fclose(handle);
 }
 //------------------------------------------------------------------------------
 void VTK::Init(const char *path) {
   if (_handle)
     return;
-  int flength = strlen(path) + 20;
+  _path = strlen(path) ? path : "field";
+  _arrays.clear();
+  _appended.clear();
+
+  // Extent of this piece and of the whole domain in global point indices
+  multi_index_t first, whole;
+  for (uint32_t d = 0; d < DIM; ++d)
+    whole[d] = _size[d] - 2;
+
+  const bool parallel = _comm && _comm->ThreadCnt() > 1;
+  if (parallel) {
+    multi_index_t size;
+    first = _comm->BlockOffset();
+    _comm->Block(_comm->ThreadCnt() - 1, whole, size);
+    for (uint32_t d = 0; d < DIM; ++d)
+      whole[d] += size[d];
+  }
+  // Position of the global point index 0
+  for (uint32_t d = 0; d < DIM; ++d)
+    _origin[d] = _offset[d] - (double)first[d] * _h[d];
+
+  const char *type = _series ? "ImageData" : "StructuredGrid";
+  int flength = _path.size() + 30;
   char *filename;
   filename = new char[flength];
-  if (strlen(path))
-    sprintf(filename, "%s_%i.vts", path, _cnt);
+  if (parallel)
+    sprintf(filename, "%s_%i_%i.%s", _path.c_str(), _cnt, _comm->ThreadNum(),
+            _series ? "vti" : "vts");
   else
-    sprintf(filename, "%s_%i.vts", "field", _cnt);
-  _handle = fopen(filename, "w");
+    sprintf(filename, "%s_%i.%s", _path.c_str(), _cnt, _series ? "vti" : "vts");
+  _handle = fopen(filename, "wb");
   delete[] filename;
 
   fprintf(_handle, "<?xml version=\"1.0\"?>\n");
-  fprintf(_handle, "<VTKFile type=\"StructuredGrid\">\n");
-  fprintf(_handle, "<StructuredGrid WholeExtent=\"0 %i 0 %i 0 %i \">\n",
-          _size[0]-2, _size[1]-2, (DIM == 3 ? _size[2]-2 : 0));
-  fprintf(_handle, "<Piece Extent=\"0 %i 0 %i 0 %i \">\n", _size[0]-2,
-          _size[1]-2, (DIM == 3 ? _size[2]-2 : 0));
+  if (_format == VTKFormat::VTK_ASCII) {
+    fprintf(_handle, "<VTKFile type=\"%s\">\n", type);
+  } else {
+    // The sizes in front of the arrays are 64 bit wide, which needs version 1.0
+    const uint16_t one = 1;
+    fprintf(_handle, "<VTKFile type=\"%s\" version=\"1.0\" "
+                     "byte_order=\"%s\" header_type=\"UInt64\"%s>\n",
+            type, *(const char *)&one ? "LittleEndian" : "BigEndian",
+            _format == VTKFormat::VTK_Compressed
+                ? " compressor=\"vtkZLibDataCompressor\"" : "");
+  }
+  fprintf(_handle, "<%s WholeExtent=\"0 %i 0 %i 0 %i \"", type,
+          whole[0], whole[1], (DIM == 3 ? whole[2] : 0));
+  if (_series)
+    fprintf(_handle, " Origin=\"%.16le %.16le %.16le\" Spacing=\"%.16le %.16le %.16le\"",
+            _origin[0], _origin[1], (DIM == 3 ? _origin[2] : 0),
+            _h[0], _h[1], (DIM == 3 ? _h[2] : 1));
+  fprintf(_handle, ">\n");
+  fprintf(_handle, "<Piece Extent=\"%i %i %i %i %i %i \">\n",
+          first[0], first[0]+_size[0]-2, first[1], first[1]+_size[1]-2,
+          (DIM == 3 ? first[2] : 0), (DIM == 3 ? first[2]+_size[2]-2 : 0));
+
+  // Image data is placed by its origin and spacing alone
+  if (_series) {
+    fprintf(_handle, "<PointData>\n");
+    return;
+  }
+
   fprintf(_handle, "<Points>\n");
-  fprintf(_handle, "<DataArray type=\"Float64\" format=\"ascii\" "
-                   "NumberOfComponents=\"3\">\n");
+  this->BeginArray("", 3);
 
   for (uint32_t z = 0; z <= (DIM == 3 ? _size[2]-2 : 0); ++z)
     for (uint32_t y = 0; y <= _size[1]-2; ++y)
-      for (uint32_t x = 0; x <= _size[0]-2; ++x)
-        fprintf(_handle, "%le %le %le\n", (double)x * _h[0] + _offset[0],
-                (double)y * _h[1] + _offset[1],
-                (DIM == 3 ? (double)z * _h[2] + _offset[2] : 0));
+      for (uint32_t x = 0; x <= _size[0]-2; ++x) {
+        this->Put((double)x * _h[0] + _offset[0]);
+        this->Put((double)y * _h[1] + _offset[1]);
+        this->Put(DIM == 3 ? (double)z * _h[2] + _offset[2] : 0);
+        this->NewLine();
+      }
 
-  fprintf(_handle, "</DataArray>\n");
+  this->EndArray();
   fprintf(_handle, "</Points>\n");
   fprintf(_handle, "<PointData>\n");
 }
@@ -74,68 +204,138 @@ void VTK::Finish() {
 
   fprintf(_handle, "</PointData>\n");
   fprintf(_handle, "</Piece>\n");
-  fprintf(_handle, "</StructuredGrid>\n");
+  fprintf(_handle, "</%s>\n", _series ? "ImageData" : "StructuredGrid");
+  if (_format != VTKFormat::VTK_ASCII) {
+    // The underscore marks the start of the data, the offsets count from the
+    // byte behind it
+    fprintf(_handle, "<AppendedData encoding=\"raw\">\n_");
+    fwrite(_appended.data(), 1, _appended.size(), _handle);
+    fprintf(_handle, "\n</AppendedData>\n");
+    _appended.clear();
+  }
   fprintf(_handle, "</VTKFile>\n");
 
   fclose(_handle);
 
   _handle = NULL;
 
+  if (_comm && _comm->ThreadCnt() > 1 && _comm->ThreadNum() == 0)
+    this->WriteParallel();
+
   _cnt++;
 }
 //------------------------------------------------------------------------------
+void VTK::WriteParallel() {
+  int flength = _path.size() + 30;
+  char *filename;
+  filename = new char[flength];
+  sprintf(filename, "%s_%i.%s", _path.c_str(), _cnt, _series ? "pvti" : "pvts");
+  FILE *handle = fopen(filename, "w");
+  delete[] filename;
+
+  // The pieces lie in the same folder as this file
+  const size_t slash = _path.rfind('/');
+  const std::string name =
+      slash == std::string::npos ? _path : _path.substr(slash + 1);
+
+  multi_index_t offset, size, whole;
+  _comm->Block(_comm->ThreadCnt() - 1, whole, size);
+  for (uint32_t d = 0; d < DIM; ++d)
+    whole[d] += size[d];
+
+  const char *type = _series ? "PImageData" : "PStructuredGrid";
+  fprintf(handle, "<?xml version=\"1.0\"?>\n");
+  fprintf(handle, "<VTKFile type=\"%s\">\n", type);
+  fprintf(handle, "<%s WholeExtent=\"0 %i 0 %i 0 %i \" GhostLevel=\"0\"", type,
+          whole[0], whole[1], (DIM == 3 ? whole[2] : 0));
+  if (_series) {
+    fprintf(handle, " Origin=\"%.16le %.16le %.16le\" Spacing=\"%.16le %.16le %.16le\">\n",
+            _origin[0], _origin[1], (DIM == 3 ? _origin[2] : 0),
+            _h[0], _h[1], (DIM == 3 ? _h[2] : 1));
+  } else {
+    fprintf(handle, ">\n");
+    fprintf(handle, "<PPoints>\n");
+    fprintf(handle, "<PDataArray type=\"Float64\" NumberOfComponents=\"3\"/>\n");
+    fprintf(handle, "</PPoints>\n");
+  }
+  fprintf(handle, "<PPointData>\n%s</PPointData>\n", _arrays.c_str());
+
+  for (int rank = 0; rank < _comm->ThreadCnt(); ++rank) {
+    _comm->Block(rank, offset, size);
+    fprintf(handle, "<Piece Extent=\"%i %i %i %i %i %i \" "
+                    "Source=\"%s_%i_%i.%s\"/>\n",
+            offset[0], offset[0]+size[0], offset[1], offset[1]+size[1],
+            (DIM == 3 ? offset[2] : 0), (DIM == 3 ? offset[2]+size[2] : 0),
+            name.c_str(), _cnt, rank, _series ? "vti" : "vts");
+  }
+
+  fprintf(handle, "</%s>\n", type);
+  fprintf(handle, "</VTKFile>\n");
+
+  fclose(handle);
+}
+//------------------------------------------------------------------------------
 void VTK::AddScalar(const char *title, const Grid *grid) {
   if (!_handle)
     return;
 
-  fprintf(_handle,
-          "<DataArray Name=\"%s\" type=\"Float64\" format=\"ascii\">\n", title);
+  this->BeginArray(title, 1);
+  _arrays += std::string("<PDataArray Name=\"") + title +
+             "\" type=\"Float64\"/>\n";
+
+  // The points lie at the same position relative to the cells of the grid,
+  // so the interpolation weights of the first point apply to all of them
+  const index_t stride = _size[0];
+  index_t first;
+  real_t weight[4];
+  grid->InterpolationWeights(_offset, first, weight);
+  const real_t *data = grid->Data();
 
-  multi_real_t pos;
   for (uint32_t z = 0; z <= (DIM == 3 ? _size[2]-2 : 0); ++z) {
-#if DIM == 3
-    pos[2] = (double)z * _h[2] + _offset[2];
-#endif // DIM
     for (uint32_t y = 0; y <= _size[1]-2; ++y) {
-      pos[1] = (double)y * _h[1] + _offset[1];
       for (uint32_t x = 0; x <= _size[0]-2; ++x) {
-        pos[0] = (double)x * _h[0] + _offset[0];
-        fprintf(_handle, "%le ", (double)grid->Interpolate(pos));
+        this->Put(Weighted(data, first + y * stride + x, stride, weight));
 #if DIM == 3
-        fprintf(_handle, "\n");
+        this->NewLine();
 #endif // DIM
       }
 #if DIM == 2
-      fprintf(_handle, "\n");
+      this->NewLine();
 #endif // DIM
     }
   }
 
-  fprintf(_handle, "</DataArray>\n");
+  this->EndArray();
 }
 //------------------------------------------------------------------------------
 void VTK::AddField(const char *title, const Grid *v1, const Grid *v2) {
   if (!_handle)
     return;
 
-  fprintf(_handle, "<DataArray Name=\"%s\" type=\"Float64\" format=\"ascii\" "
-                   "NumberOfComponents=\"3\">\n",
-          title);
+  this->BeginArray(title, 3);
+  _arrays += std::string("<PDataArray Name=\"") + title +
+             "\" type=\"Float64\" NumberOfComponents=\"3\"/>\n";
+
+  // Fixed interpolation weights of each component, see AddScalar
+  const index_t stride = _size[0];
+  index_t first1, first2;
+  real_t weight1[4], weight2[4];
+  v1->InterpolationWeights(_offset, first1, weight1);
+  v2->InterpolationWeights(_offset, first2, weight2);
+  const real_t *data1 = v1->Data();
+  const real_t *data2 = v2->Data();
 
-  multi_real_t pos;
-#if DIM == 3
-  pos[2] = 0;
-#endif // DIM
   for (uint32_t y = 0; y <= _size[1]-2; ++y) {
-    pos[1] = (double)y * _h[1] + _offset[1];
     for (uint32_t x = 0; x <= _size[0]-2; ++x) {
-      pos[0] = (double)x * _h[0] + _offset[0];
-      fprintf(_handle, "%le %le 0\n", (double)v1->Interpolate(pos),
-              (double)v2->Interpolate(pos));
+      const index_t k = y * stride + x;
+      this->Put(Weighted(data1, first1 + k, stride, weight1));
+      this->Put(Weighted(data2, first2 + k, stride, weight2));
+      this->Put(0);
+      this->NewLine();
     }
   }
 
-  fprintf(_handle, "</DataArray>\n");
+  this->EndArray();
 }
 //------------------------------------------------------------------------------
 void VTK::AddField(const char *title, const Grid *v1, const Grid *v2,
@@ -143,29 +343,98 @@ void VTK::AddField(const char *title, const Grid *v1, const Grid *v2,
   if (!_handle)
     return;
 
-  fprintf(_handle, "<DataArray Name=\"%s\" type=\"Float64\" format=\"ascii\" "
-                   "NumberOfComponents=\"3\">\n",
-          title);
+  this->BeginArray(title, 3);
+  _arrays += std::string("<PDataArray Name=\"") + title +
+             "\" type=\"Float64\" NumberOfComponents=\"3\"/>\n";
+
+  // Fixed interpolation weights of each component, see AddScalar
+  const index_t stride = _size[0];
+  index_t first1, first2, first3;
+  real_t weight1[4], weight2[4], weight3[4];
+  v1->InterpolationWeights(_offset, first1, weight1);
+  v2->InterpolationWeights(_offset, first2, weight2);
+  v3->InterpolationWeights(_offset, first3, weight3);
+  const real_t *data1 = v1->Data();
+  const real_t *data2 = v2->Data();
+  const real_t *data3 = v3->Data();
 
-  multi_real_t pos;
-#if DIM == 3
-  pos[2] = 0;
-#endif // DIM
   for (uint32_t y = 0; y <= _size[1]-2; ++y) {
-    pos[1] = (double)y * _h[1] + _offset[1];
     for (uint32_t x = 0; x <= _size[0]-2; ++x) {
-      pos[0] = (double)x * _h[0] + _offset[0];
-      fprintf(_handle, "%le %le %le\n", (double)v1->Interpolate(pos),
-              (double)v2->Interpolate(pos), (double)v3->Interpolate(pos));
+      const index_t k = y * stride + x;
+      this->Put(Weighted(data1, first1 + k, stride, weight1));
+      this->Put(Weighted(data2, first2 + k, stride, weight2));
+      this->Put(Weighted(data3, first3 + k, stride, weight3));
+      this->NewLine();
     }
   }
 
-  fprintf(_handle, "</DataArray>\n");
+  this->EndArray();
+}
+//------------------------------------------------------------------------------
+void VTK::BeginArray(const char *title, const index_t &components) {
+  fprintf(_handle, "<DataArray ");
+  if (strlen(title))
+    fprintf(_handle, "Name=\"%s\" ", title);
+  fprintf(_handle, "type=\"Float64\" ");
+  if (components > 1)
+    fprintf(_handle, "NumberOfComponents=\"%i\" ", components);
+  if (_format == VTKFormat::VTK_ASCII)
+    fprintf(_handle, "format=\"ascii\">\n");
+  else
+    fprintf(_handle, "format=\"appended\" offset=\"%lu\"/>\n",
+            (unsigned long)_appended.size());
+  _values.clear();
+}
+//------------------------------------------------------------------------------
+void VTK::Put(const double &value) {
+  if (_format == VTKFormat::VTK_ASCII)
+    fprintf(_handle, "%le ", value);
+  else
+    _values.push_back(value);
+}
+//------------------------------------------------------------------------------
+void VTK::NewLine() {
+  if (_format == VTKFormat::VTK_ASCII)
+    fprintf(_handle, "\n");
+}
+//------------------------------------------------------------------------------
+void VTK::EndArray() {
+  if (_format == VTKFormat::VTK_ASCII) {
+    fprintf(_handle, "</DataArray>\n");
+    return;
+  }
+
+  const uint64_t bytes = _values.size() * sizeof(double);
+  if (_format == VTKFormat::VTK_Binary) {
+    AppendBytes(_appended, bytes);
+    _appended.append((const char *)_values.data(), bytes);
+    return;
+  }
+
+  // The values are compressed as a single block. The header holds the number
+  // of blocks, the size of a block, the size of the last block before and
+  // the size of each block after compression
+  uLongf length = compressBound(bytes);
+  Bytef *block = new Bytef[length];
+  if (compress2(block, &length, (const Bytef *)_values.data(), bytes,
+                VTK_ZLIB_LEVEL) != Z_OK) {
+    delete[] block;
+    throw std::runtime_error("Compression of VTK data failed");
+  }
+  AppendBytes(_appended, (uint64_t)1);
+  AppendBytes(_appended, bytes);
+  AppendBytes(_appended, bytes);
+  AppendBytes(_appended, (uint64_t)length);
+  _appended.append((const char *)block, length);
+  delete[] block;
 }
 //------------------------------------------------------------------------------
 void VTK::InitParticles(const char *path){
   if (_handle)
     return;
+  // All processes hold the same particles, the first one writes them
+  if (_comm && _comm->ThreadNum() != 0)
+    return;
   int flength = strlen(path) + 20;
   char *filename;
   filename = new char[flength];
@@ -193,20 +462,30 @@ void VTK::FinishParticles(){
   _handle = NULL;
 }
 //------------------------------------------------------------------------------
-void VTK::AddParticles(list<particles_t> *particles){
+void VTK::AddParticles(const Particles *particles){
   if (!_handle)
     return;
   
-  // Cycle the list of different streaklines / traces
-  for (list<particles_t>::iterator it_list=particles->begin(); it_list!=particles->end(); ++it_list) {
-    fprintf(_handle, "<Piece NumberOfPoints=\"%li \" NumberOfVerts=\"0\" NumberOfLines=\"0\" NumberOfStrips=\"0\" NumberOfPolys=\"0\">\n", it_list->size());
+  const index_t  n    = particles->Size();
+  const index_t *line = particles->Line();
+  const real_t  *x    = particles->X();
+  const real_t  *y    = particles->Y();
+
+  // Count the particles of each line, since the lines are interleaved
+  std::vector<index_t> count(particles->Lines(), 0);
+  for (index_t i = 0; i < n; ++i)
+    ++count[line[i]];
+
+  // Cycle the different streaklines / traces
+  for (index_t l = 0; l < particles->Lines(); ++l) {
+    fprintf(_handle, "<Piece NumberOfPoints=\"%li \" NumberOfVerts=\"0\" NumberOfLines=\"0\" NumberOfStrips=\"0\" NumberOfPolys=\"0\">\n", (long)count[l]);
     fprintf(_handle, "<Points>\n");
     fprintf(_handle, "<DataArray type=\"Float64\" format=\"ascii\" "
                     "NumberOfComponents=\"3\">\n");
 
-    for (iter_particles_t it=it_list->begin(); it!=it_list->end(); ++it) {
-      multi_real_t data = *it;
-      fprintf( _handle, "%le %le %le\n", data[0], data[1], (DIM == 3 ? data[2] : 0) );
+    for (index_t i = 0; i < n; ++i) {
+      if (line[i] != l) continue;
+      fprintf( _handle, "%le %le %le\n", double(x[i]), double(y[i]), 0.0 );
     }
 
     fprintf(_handle, "</DataArray>\n");
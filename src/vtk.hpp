@@ -18,6 +18,9 @@
 #include "typedef.hpp"
 #include "grid.hpp"
 #include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
 //------------------------------------------------------------------------------
 #ifndef __VTK_HPP
 #define __VTK_HPP
@@ -33,9 +36,19 @@ public:
   VTK(const multi_real_t &h, const multi_index_t &size);
   VTK(const multi_real_t &h, const multi_index_t &size,
       const multi_real_t &offset);
+  VTK(const multi_real_t &h, const multi_index_t &size,
+      const Communicator *comm);
+
+  /// Sets the encoding of the following files
+  void SetFormat(const index_t &format);
+
+  /// Writes the following grid files as image data without point coordinates
+  void SetSeries(const bool &series);
 
   /// Initializes the file
   void Init(const char *path);
+  /// Initializes the file and adds it to the time series of the path
+  void Init(const char *path, const real_t &time);
   /// Closes the file
   void Finish();
 
@@ -53,13 +66,45 @@ public:
   void FinishParticles();
   
   /// Add a particle data
-  void AddParticles(list<particles_t> *particles);
+  void AddParticles(const Particles *particles);
+
+  /// Returns the number of files written so far, which numbers the next file
+  static uint32_t Count();
+  /// Continues the numbering of the files, e.g. after a restart
+  static void SetCount(const uint32_t &count);
 private:
   const multi_real_t &_h;
   const multi_index_t &_size;
   multi_real_t _offset;
   FILE *_handle;
 
+  const Communicator *_comm;
+  std::string _path;
+  std::string _arrays;
+
+  index_t _format;
+  bool _series;
+  /// Position of the global point index 0
+  multi_real_t _origin;
+  /// Entries of the collection file of each path written with a time
+  std::map<std::string, std::string> _collections;
+  /// Values of the data array being written in a binary format
+  std::vector<double> _values;
+  /// Encoded data arrays of the file, written after the XML structure
+  std::string _appended;
+
+  /// Writes the file of a parallel run combining the pieces of all processes
+  void WriteParallel();
+
+  /// Starts a data array, an empty title leaves out the name
+  void BeginArray(const char *title, const index_t &components);
+  /// Writes one value of the current data array
+  void Put(const double &value);
+  /// Ends a line of the current data array in the ASCII format
+  void NewLine();
+  /// Ends the current data array and appends its encoded values
+  void EndArray();
+
   static uint32_t _cnt;
 };
 //------------------------------------------------------------------------------
@@ -84,6 +129,37 @@ private:
  *      domains grid points depending on \p h and \p size. All grid nodes are
  *      shifted by \p offset.
  */
+/*!     \fn     VTK::VTK (const multi_real_t& h, const multi_index_t& size,
+ * const Communicator* comm)
+ *      \param h                The mesh width of the data grids to visualize
+ *      \param size             The size of the block of this process
+ *      \param comm             The communicator of the parallel run
+ *
+ *      Constructs an instance of the VTK class for the block of this process.
+ *      If there is more than one process, each process writes its block to
+ *      a file named like "field_xxx_rank.vts" and the first process writes
+ *      a file "field_xxx.pvts" that combines the blocks. Particles are only
+ *      written by the first process.
+ */
+/*!     \fn void VTK::SetFormat (const index_t& format)
+ *      \param format   The encoding of the data arrays, see VTKFormat
+ *
+ *      Selects how the data arrays of the following grid files are stored.
+ *      VTK_ASCII writes every value as text inside its DataArray element.
+ *      VTK_Binary stores the raw values in an AppendedData section at the end
+ *      of the file, each array preceded by its size in bytes. VTK_Compressed
+ *      stores them compressed with zlib in the same section. Particle files
+ *      are always written as text.
+ */
+/*!     \fn void VTK::SetSeries (const bool& series)
+ *      \param series   True to write image data
+ *
+ *      The grid of all files is the same uniform mesh, so with \p series the
+ *      files are written as image data (".vti" and ".pvti"), which describes
+ *      the mesh by its origin and spacing instead of storing the coordinates
+ *      of all points. Otherwise structured grids (".vts" and ".pvts") with
+ *      explicit point coordinates are written.
+ */
 /*!     \fn void VTK::Init (const char* path)
  *      \param path     The path and filename of the VTK files.
  *
@@ -94,6 +170,14 @@ private:
  * ".vts".
  *      If the path is left empty, the files will be named like "field_xxx.vts".
  */
+/*!     \fn void VTK::Init (const char* path, const real_t& time)
+ *      \param path     The path and filename of the VTK files.
+ *      \param time     The simulation time of the file
+ *
+ *      Initializes the file like Init(path) and adds it with its simulation
+ *      time to the collection "path.pvd". Opening this collection in Paraview
+ *      shows the files as a time series with the real time values.
+ */
 /*!     \fn void AddScalar (const char* title, const Grid* grid)
  *      \param title    The name of the field in the VTK file
  *      \param grid             The grid with the scalar values.